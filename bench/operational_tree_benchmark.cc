@@ -0,0 +1,152 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+// Compares building the operational hardware tree node by node through setXpath with building it
+// from one JSON document, for synthetic inventories of 100, 1000 and 10000 components or of the
+// sizes given as arguments. Both builds use the context of a sysrepo session, so sysrepo has to
+// be set up with ietf-hardware and the augment modules installed.
+
+#include <json_tree.h>
+#include <sensor_data.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sysrepo-cpp/Connection.hpp>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// A chassis with modules in it, every fourth component is a sensor
+hardware::ComponentMap makeInventory(size_t count) {
+    hardware::ComponentMap hwComponents;
+    auto chassis(std::make_shared<hardware::ComponentData>("chassis", "iana-hardware:chassis"));
+    chassis->description = "Benchmark chassis";
+    chassis->serial = "CH-0001";
+    chassis->mfgName = "Deutsche Telekom AG";
+    hwComponents.emplace(chassis->name, chassis);
+
+    for (size_t i = 1; i < count; ++i) {
+        std::string const name("component-" + std::to_string(i));
+        std::shared_ptr<hardware::ComponentData> component;
+        if (i % 4 == 0) {
+            auto sensor(std::make_shared<hardware::Sensor>(name));
+            sensor->value = int32_t(i % 100);
+            sensor->valueType = hardware::Sensor::ValueType::celsius;
+            component = sensor;
+        } else {
+            component = std::make_shared<hardware::ComponentData>(name, "iana-hardware:module");
+            component->description = "Benchmark module " + std::to_string(i);
+            component->hardwareRev = "1.0";
+            component->serial = "MOD-" + std::to_string(i);
+            component->mfgName = "Deutsche Telekom AG";
+            component->modelName = "Model " + std::to_string(i % 16);
+        }
+        component->parentName = chassis->name;
+        component->parent_rel_pos = int32_t(i);
+        chassis->children.push_back(name);
+        hwComponents.emplace(name, component);
+    }
+    return hwComponents;
+}
+
+double milliseconds(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+double median(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+// Nodes of a built tree, 0 if nothing was built
+size_t nodeCount(std::optional<libyang::DataNode> const& tree) {
+    size_t count(0);
+    if (tree) {
+        for (auto const& sibling : tree->siblings()) {
+            for (auto const& node : sibling.childrenDfs()) {
+                (void)node;
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+template <typename Build>
+double measure(size_t iterations, Build const& build) {
+    std::vector<double> samples;
+    // the first run only warms up, e.g. the thread local JSON buffer
+    build();
+    for (size_t i = 0; i < iterations; ++i) {
+        Clock::time_point const start(Clock::now());
+        build();
+        samples.emplace_back(milliseconds(Clock::now() - start));
+    }
+    return median(samples);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i) {
+        sizes.emplace_back(std::strtoul(argv[i], nullptr, 10));
+    }
+    if (sizes.empty()) {
+        sizes = {100, 1000, 10000};
+    }
+
+    sysrepo::Connection conn;
+    sysrepo::Session session(conn.sessionStart());
+    std::string const hardwarePath("/ietf-hardware:hardware");
+    std::string const lastChange("2026-10-17T00:00:00Z");
+
+    printf("%12s %14s %14s %10s\n", "components", "setXpath [ms]", "json [ms]", "speedup");
+    for (size_t const size : sizes) {
+        if (size == 0) {
+            continue;
+        }
+        hardware::ComponentMap const hwComponents(makeInventory(size));
+        size_t const iterations(std::max<size_t>(5, 20000 / size));
+
+        auto const buildNodes = [&] {
+            std::optional<libyang::DataNode> parent;
+            setXpath(session, parent, hardwarePath + "/last-change", lastChange);
+            for (auto const& c : hwComponents) {
+                c.second->setXpathForAllMembers(session, parent, hardwarePath);
+            }
+            return parent;
+        };
+        auto const buildJson = [&] {
+            return hardware::JsonTree::build(session.getContext(), lastChange, hwComponents,
+                                             false, std::nullopt);
+        };
+
+        // a build failing fast, e.g. without the hardware-sensor feature, isn't a speedup
+        size_t const expected(nodeCount(buildNodes()));
+        size_t const built(nodeCount(buildJson()));
+        if (expected == 0 || built != expected) {
+            fprintf(stderr,
+                    "The builds of %zu components differ, setXpath: %zu nodes, json: %zu nodes. "
+                    "Are ietf-hardware with hardware-sensor and the augment modules installed?\n",
+                    size, expected, built);
+            return EXIT_FAILURE;
+        }
+
+        double const nodes(measure(iterations, buildNodes));
+        double const json(measure(iterations, buildJson));
+        printf("%12zu %14.3f %14.3f %9.2fx\n", size, nodes, json, nodes / json);
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef ADAPTIVE_POLL_H
+#define ADAPTIVE_POLL_H
+
+#include <component_data.h>
+#include <utils/globals.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <optional>
+
+namespace hardware {
+
+// Poll interval of a monitored sensor that adapts to how close its value is to the nearest
+// threshold. Within ADAPTIVE_POLL_PROXIMITY percent of a threshold value the interval shrinks
+// linearly towards the minimum, and it is kept short enough to take ADAPTIVE_POLL_SAMPLES samples
+// before the threshold would be reached at the current rate of change. Far from any threshold
+// the interval relaxes back to the maximum, at most doubling from one sample to the next.
+struct AdaptivePollState {
+
+    using Clock = std::chrono::steady_clock;
+
+    AdaptivePollState(uint64_t minimumTicks, uint64_t maximumTicks)
+        : minTicks(minimumTicks), maxTicks(maximumTicks), intervalTicks(minimumTicks){};
+
+    // The state starts over when the bounds it was built for have been reconfigured
+    bool matches(uint64_t minimumTicks, uint64_t maximumTicks) const {
+        return minTicks == minimumTicks && maxTicks == maximumTicks;
+    }
+
+    uint64_t update(int32_t sensorValue,
+                    Clock::time_point now,
+                    SensorThresholdList const& thresholds) {
+        uint64_t target(maxTicks);
+        int64_t nearest(-1);
+        for (auto const& threshold : thresholds) {
+            int64_t const distance(std::llabs(int64_t(sensorValue) - threshold->value));
+            int64_t const band(
+                std::max<int64_t>(1, std::llabs(threshold->value) * ADAPTIVE_POLL_PROXIMITY / 100));
+            if (distance < band) {
+                target = std::min(target, minTicks + (maxTicks - minTicks) * distance / band);
+            }
+            if (nearest < 0 || distance < nearest) {
+                nearest = distance;
+            }
+        }
+
+        if (previousValue && nearest >= 0) {
+            int64_t const change(std::llabs(int64_t(sensorValue) - previousValue.value()));
+            int64_t const elapsed(
+                std::chrono::duration_cast<std::chrono::milliseconds>(now - previousTime).count());
+            if (change > 0 && elapsed > 0) {
+                // time until the nearest threshold is reached at the current rate
+                int64_t const remaining(nearest * elapsed / change);
+                target = std::min<uint64_t>(
+                    target, remaining / (SAMPLER_TICK_MS * ADAPTIVE_POLL_SAMPLES));
+            }
+        }
+
+        previousValue = sensorValue;
+        previousTime = now;
+        intervalTicks = std::clamp(std::min(target, intervalTicks * 2), minTicks, maxTicks);
+        return intervalTicks;
+    }
+
+    uint64_t minTicks;
+    uint64_t maxTicks;
+    uint64_t intervalTicks;
+    std::optional<int32_t> previousValue;
+    Clock::time_point previousTime;
+};
+
+}  // namespace hardware
+
+#endif  // ADAPTIVE_POLL_H
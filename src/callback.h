@@ -12,14 +12,23 @@
 #define CALLBACK_H
 
 #include <component_data.h>
+#include <config_changes.h>
+#include <inventory_cache.h>
+#include <json_tree.h>
+#include <operational_pusher.h>
+#include <plugin_settings.h>
+#include <request_filter.h>
 #include <sensor_data.h>
-#include <utils/rapidjson/document.h>
-#include <utils/rapidjson/istreamwrapper.h>
+#include <tree_cache.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <fstream>
+#include <cstdio>
+#include <ctime>
 #include <hardware_sensors.h>
 #include <mutex>
+#include <set>
 #include <sysrepo-cpp/Enum.hpp>
 
 namespace hardware {
@@ -28,9 +37,6 @@ struct Callback {
     using Session = sysrepo::Session;
     using ErrorCode = sysrepo::ErrorCode;
     using Event = sysrepo::Event;
-    using Value = rapidjson::Value;
-    using Document = rapidjson::Document;
-    using IStreamWrapper = rapidjson::IStreamWrapper;
 
     static ErrorCode configurationCallback(Session session,
                                            uint32_t subscriptionId,
@@ -38,11 +44,108 @@ struct Callback {
                                            std::optional<std::string_view> /* subXPath */,
                                            Event /* event */,
                                            uint32_t /* request_id */) {
+        // the initial configuration is applied as a whole, whichever event delivers it
+        ConfigChanges const changes(!configurationApplied.exchange(true)
+                                        ? ConfigChanges::everything()
+                                        : ConfigChanges::collect(session, moduleName));
+        if (!changes.all && !changes.settings) {
+            applyComponentChanges(session, moduleName, changes);
+            return ErrorCode::Ok;
+        }
+        applyConfiguration(session, moduleName);
+        return ErrorCode::Ok;
+    }
+
+    // Applies the startup configuration if subscribing didn't call the configuration callback
+    static void applyInitialConfiguration(Session& session, std::string_view moduleName) {
+        if (!configurationApplied.exchange(true)) {
+            applyConfiguration(session, moduleName);
+        }
+    }
+
+    static void resetConfiguration() {
+        configurationApplied = false;
+    }
+
+    static void applyConfiguration(Session& session, std::string_view moduleName) {
         printCurrentConfig(session, moduleName);
         logMessage(SR_LL_DBG, "Processing received configuration.");
-        HardwareSensors::getInstance().notifyAndJoin();
         ComponentData::populateConfigData(session, moduleName);
-        HardwareSensors::getInstance().startThreads();
+        PluginSettings::populateSettings(session, moduleName);
+        auto const settings(PluginSettings::get());
+        HardwareSensors::getInstance().rescan(settings->sensorReader);
+        InventoryCache::getInstance().setTimeToLive(settings->inventoryCacheTTL);
+        InventoryCache::getInstance().setCollector(settings->inventoryCollector);
+        InventoryCache::getInstance().invalidate();
+        HardwareSensors::getInstance().reconfigure(settings->sensorSampleInterval,
+                                                   settings->notificationOverflow,
+                                                   settings->historyWindows);
+        HardwareSensors::getInstance().configureStore(settings->timeseriesStore,
+                                                      settings->timeseriesRetention);
+        OperationalPusher::getInstance().notify();
+    }
+
+    // Only the changed components are read again. Unchanged sensors keep being sampled with their
+    // timing and threshold states, the inventory is only collected again if inventory values
+    // changed.
+    static void applyComponentChanges(Session& session,
+                                      std::string_view moduleName,
+                                      ConfigChanges const& changes) {
+        std::set<std::string> const components(changes.components());
+        if (components.empty()) {
+            return;
+        }
+        logMessage(SR_LL_DBG, "Applying configuration changes of " +
+                                  std::to_string(components.size()) + " components.");
+        ComponentData::updateConfigData(session, moduleName, components);
+        if (!changes.inventoryComponents.empty()) {
+            InventoryCache::getInstance().invalidate();
+        }
+        if (!changes.monitoredSensors.empty()) {
+            HardwareSensors::getInstance().updateMonitoredSensors(
+                changes.monitoredSensors, PluginSettings::get()->sensorSampleInterval);
+        }
+        OperationalPusher::getInstance().notify();
+    }
+
+    // Serves get-sensor-history from the persisted sensor samples
+    static ErrorCode sensorHistoryCallback(Session /* session */,
+                                           uint32_t /* subscriptionId */,
+                                           std::string_view path,
+                                           libyang::DataNode const input,
+                                           Event /* event */,
+                                           uint32_t /* requestId */,
+                                           libyang::DataNode output) {
+        std::set<std::string> sensorNames;
+        std::optional<std::chrono::system_clock::time_point> start, end;
+        for (auto const& node : input.immediateChildren()) {
+            std::string const name(node.schema().name());
+            if (name == "sensor") {
+                sensorNames.emplace(node.asTerm().valueStr());
+            } else if (name == "start") {
+                start = parseDateAndTime(std::string(node.asTerm().valueStr()));
+            } else if (name == "end") {
+                end = parseDateAndTime(std::string(node.asTerm().valueStr()));
+            }
+        }
+        if (!start) {
+            logMessage(SR_LL_WRN, "get-sensor-history: invalid start time.");
+            return ErrorCode::InvalidArgument;
+        }
+
+        auto const history(HardwareSensors::getInstance().querySamples(
+            sensorNames, start.value(), end.value_or(std::chrono::system_clock::now())));
+        for (auto const& [name, samples] : history) {
+            if (samples.empty()) {
+                continue;
+            }
+            std::string const sensorPath(std::string(path) + "/sensor[name='" + name + "']");
+            for (auto const& [timestamp, value] : samples) {
+                output.newPath(sensorPath + "/sample[timestamp='" + formatDateAndTime(timestamp) +
+                                   "']/value",
+                               std::to_string(value), libyang::CreationOptions::Output);
+            }
+        }
         return ErrorCode::Ok;
     }
 
@@ -50,41 +153,47 @@ struct Callback {
                                          uint32_t subscriptionId,
                                          std::string_view moduleName,
                                          std::optional<std::string_view> /* subXPath */,
-                                         std::optional<std::string_view> /* requestXPath */,
+                                         std::optional<std::string_view> requestXPath,
                                          uint32_t /* requestId */,
                                          std::optional<libyang::DataNode>& parent) {
+        return buildOperationalTree(session, moduleName, requestXPath, parent,
+                                    InventoryCache::getInstance().requestSnapshot());
+    }
 
-        int rc = system("/usr/bin/lshw -json > " COMPONENTS_LOCATION);
-        if (rc == -1) {
-            logMessage(SR_LL_ERR, "lshw command failed");
-            return ErrorCode::CallbackFailed;
-        }
-        logMessage(SR_LL_DBG, "lshw command returned:" + std::to_string(rc));
+    static ErrorCode buildOperationalTree(Session& session,
+                                          std::string_view moduleName,
+                                          std::optional<std::string_view> requestXPath,
+                                          std::optional<libyang::DataNode>& parent,
+                                          std::shared_ptr<InventorySnapshot const> inventory) {
         std::string const set_xpath("/ietf-hardware:hardware");
+        auto const config(ComponentData::configData());
 
         // +--ro last-change?   yang:date-and-time
         std::time_t lastChange(
-            std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+            inventory ? inventory->lastChange
+                      : std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
         char timeString[100];
+        std::optional<std::string> lastChangeString;
         if (std::strftime(timeString, sizeof(timeString), "%FT%TZ", std::localtime(&lastChange))) {
-            setXpath(session, parent, set_xpath + "/last-change", timeString);
-        }
-
-        std::ifstream ifs(COMPONENTS_LOCATION, std::ifstream::in);
-        if (ifs.fail()) {
-            logMessage(SR_LL_ERR, "Can't open: " COMPONENTS_LOCATION);
-            return ErrorCode::CallbackFailed;
-        }
-        IStreamWrapper isw(ifs);
-        Document doc;
-        doc.ParseStream(isw);
-        if (!doc.IsObject() && !doc.IsArray()) {
-            logMessage(SR_LL_ERR, "lshw json root-node is not an object or array");
-            return ErrorCode::CallbackFailed;
+            lastChangeString = timeString;
         }
 
+        RequestFilter const filter(RequestFilter::parse(requestXPath));
+        bool const withStatistics(filter.inventory && !filter.componentName &&
+                                  pluginAugmentImplemented(session));
         ComponentMap hwComponents;
-        parseAndSetComponents(doc, hwComponents, std::string());
+        if (filter.inventory) {
+            if (!inventory) {
+                logMessage(SR_LL_DBG, "Hardware inventory not collected yet.");
+            } else if (filter.componentName) {
+                auto const& component = inventory->components.find(filter.componentName.value());
+                if (component != inventory->components.end()) {
+                    hwComponents.insert(*component);
+                }
+            } else {
+                hwComponents = inventory->components;
+            }
+        }
 
         auto const& modules = session.getContext().modules();
         auto module = std::find_if(
@@ -92,157 +201,167 @@ struct Callback {
             [moduleName](libyang::Module const& module) { return moduleName == module.name(); });
 
         try {
-            if (module != std::end(modules) && module->featureEnabled("hardware-sensor")) {
-                HardwareSensors::getInstance().parseSensorData(hwComponents);
+            // component names are unique, a requested inventory component isn't a sensor
+            bool const sensorsSelected(filter.sensors &&
+                                       !(filter.componentName && !hwComponents.empty()));
+            if (sensorsSelected && module != std::end(modules) &&
+                module->featureEnabled("hardware-sensor")) {
+                HardwareSensors::getInstance().parseSensorData(hwComponents, filter,
+                                                               pluginAugmentImplemented(session));
             }
         } catch (std::exception const& e) {
             logMessage(SR_LL_WRN, "hardware-sensors nodes failure: " + std::string(e.what()));
         }
 
-        for (auto const& c : hwComponents) {
-            c.second->setXpathForAllMembers(session, parent, set_xpath,
-                                            (module != std::end(modules)) &&
-                                                module->featureEnabled("entity-mib"));
+        bool const setPhysicalID((module != std::end(modules)) &&
+                                 module->featureEnabled("entity-mib"));
+        std::optional<JsonTree::Statistics> statistics;
+        if (withStatistics) {
+            statistics =
+                JsonTree::Statistics{HardwareSensors::getInstance().droppedNotifications(),
+                                     HardwareSensors::getInstance().coalescedNotifications()};
         }
 
-        if (!parent) {
-            logMessage(SR_LL_ERR, "No nodes were set");
-            return ErrorCode::CallbackFailed;
-        }
-        return ErrorCode::Ok;
-    }
-
-    static std::string toIANAclass(std::string const& inputClass) {
-        std::string returnedClass("iana-hardware:unknown");
-        static std::unordered_map<std::string, std::string> _{
-            {"storage", "iana-hardware:storage-drive"},
-            {"power", "iana-hardware:battery"},
-            {"processor", "iana-hardware:cpu"},
-            {"network", "iana-hardware:port"}};
-
-        if (_.find(inputClass) != _.end()) {
-            returnedClass = _.at(inputClass);
-        }
-        return returnedClass;
-    }
-
-    static std::string parseAndSetComponent(Value const& parsee,
-                                            std::string const& parentName,
-                                            Value::ConstMemberIterator itr,
-                                            ComponentMap& hwComponents,
-                                            int32_t& parent_rel_pos) {
-        std::shared_ptr<ComponentData> component;
-        if (itr != parsee.MemberEnd()) {
-            component = std::make_shared<ComponentData>(itr->value.GetString());
-        } else {
-            // invalid entry, go to the next one
-            return std::string();
-        }
-
-        // firmware node, skip this one and set the parent's firmware-rev
-        // +--ro firmware-rev?     string
-        if (component->name == "firmware" && !parentName.empty() &&
-            (itr = parsee.FindMember("version")) != parsee.MemberEnd()) {
-            if (hwComponents.find(parentName) != hwComponents.end() && hwComponents[parentName]) {
-                hwComponents[parentName]->firmwareRev = itr->value.GetString();
+        // only a tree of the whole hardware is cached
+        std::optional<TreeCache::Key> cacheKey;
+        if (!parent && filter.inventory && filter.sensors && !filter.componentName) {
+            cacheKey = TreeCache::Key{inventory, config, TreeCache::shape(hwComponents),
+                                      setPhysicalID, withStatistics};
+            parent = TreeCache::getInstance().get(cacheKey.value(), lastChangeString,
+                                                  hwComponents, statistics);
+            if (parent) {
+                return ErrorCode::Ok;
             }
-            return std::string();
         }
 
-        // Check if a node with the current name exists, if so rename the current one
-        if (hwComponents.find(component->name) != hwComponents.end()) {
-            component->name = parentName + ":" + component->name;
+        bool built(false);
+        if (PluginSettings::get()->operationalTreeBuild == PluginSettings::TreeBuild::json &&
+            !parent) {
+            parent = JsonTree::build(session.getContext(), lastChangeString, hwComponents,
+                                     setPhysicalID, statistics);
+            built = parent.has_value();
         }
-
-        // +--rw class             identityref
-        if ((itr = parsee.FindMember("class")) != parsee.MemberEnd()) {
-            component->classType = toIANAclass(itr->value.GetString());
-        }
-
-        // +--rw name              string
-        // +--ro description?      string
-        // +--ro hardware-rev?     string
-        // +--ro serial-num?       string
-        // +--ro mfg-name?         string
-        // +--ro model-name?       string
-        // +--rw alias?            string
-        for (auto const& mapValue : getLSHWtoIETFmap()) {
-            std::string const stringValue = mapValue.first;
-            if ((itr = parsee.FindMember(stringValue.c_str())) != parsee.MemberEnd()) {
-                component->setValueFromLSHWmap(stringValue, itr->value.GetString());
+        if (!built) {
+            if (lastChangeString) {
+                setXpath(session, parent, set_xpath + "/last-change", lastChangeString.value());
             }
-        }
-
-        // +--ro software-rev?     string
-        // +--ro uuid?             yang:uuid
-        if ((itr = parsee.FindMember("configuration")) != parsee.MemberEnd()) {
-            Value::ConstMemberIterator config_elem = itr->value.FindMember("uuid");
-            if (config_elem != itr->value.MemberEnd()) {
-                component->uuid = config_elem->value.GetString();
+            if (statistics) {
+                setPluginStatistics(session, parent, statistics.value());
             }
-            if ((config_elem = itr->value.FindMember("driverversion")) != itr->value.MemberEnd()) {
-                component->softwareRev = config_elem->value.GetString();
-            }
-            if ((config_elem = itr->value.FindMember("firmware")) != itr->value.MemberEnd()) {
-                component->firmwareRev = config_elem->value.GetString();
+            for (auto const& c : hwComponents) {
+                c.second->setXpathForAllMembers(session, parent, set_xpath, setPhysicalID);
             }
         }
 
-        // +--ro physical-index?   int32 {entity-mib}?
-        if ((itr = parsee.FindMember("physid")) != parsee.MemberEnd()) {
-            component->parseAndSetPhysicalID(itr->value.GetString());
+        if (!parent) {
+            logMessage(SR_LL_ERR, "No nodes were set");
+            return ErrorCode::CallbackFailed;
         }
-
-        // +--rw parent?           -> ../../component/name
-        // +--rw parent-rel-pos?   int32
-        if (!parentName.empty()) {
-            component->parentName = parentName;
-            component->parent_rel_pos = parent_rel_pos;
-            parent_rel_pos++;
+        if (cacheKey) {
+            TreeCache::getInstance().store(cacheKey.value(), parent.value());
         }
+        return ErrorCode::Ok;
+    }
 
-        // Filter parsed component through configuration values
-        for (auto const& configData : ComponentData::hwConfigData) {
-            if (configData && component->checkForConfigMatch(configData)) {
-                component->replaceWritableValues(configData);
-            }
+    // Whole operational hardware tree as it is pushed into the operational datastore
+    static std::optional<libyang::DataNode> operationalTree(Session& session) {
+        std::optional<libyang::DataNode> tree;
+        // an inventory with a time-to-live of 0 isn't collected for every sample batch
+        if (buildOperationalTree(session, "ietf-hardware", std::nullopt, tree,
+                                 InventoryCache::getInstance().getSnapshot()) != ErrorCode::Ok) {
+            return std::nullopt;
         }
+        return tree;
+    }
 
-        hwComponents.insert(std::make_pair(component->name, component));
-
-        // +--ro contains-child*   -> ../../component/name
-        if ((itr = parsee.FindMember("children")) != parsee.MemberEnd()) {
-            hwComponents[component->name]->children =
-                parseAndSetComponents(itr->value.GetArray(), hwComponents, component->name);
+    // Latest samples of the sampled sensors for the sensor leaves of the pushed tree
+    static OperationalPusher::SensorUpdate
+        sampledSensors(Session& session, std::set<std::string> const& sensorNames) {
+        OperationalPusher::SensorUpdate update;
+        auto const& modules = session.getContext().modules();
+        bool const sensorsEnabled(
+            std::any_of(modules.begin(), modules.end(), [](libyang::Module const& module) {
+                return module.name() == "ietf-hardware" && module.featureEnabled("hardware-sensor");
+            }));
+        if (!sensorsEnabled) {
+            return update;
+        }
+        bool const withAugment(pluginAugmentImplemented(session));
+        update.sensors = HardwareSensors::getInstance().sampledSensors(sensorNames, withAugment);
+        if (withAugment) {
+            update.statistics =
+                JsonTree::Statistics{HardwareSensors::getInstance().droppedNotifications(),
+                                     HardwareSensors::getInstance().coalescedNotifications()};
         }
+        return update;
+    }
 
-        return component->name;
+    static bool pluginAugmentImplemented(Session& session) {
+        auto const& modules = session.getContext().modules();
+        return std::any_of(modules.begin(), modules.end(), [](libyang::Module const& module) {
+            return module.name() == "hardware-plugin-augment" && module.implemented();
+        });
     }
 
-    static std::list<std::string> parseAndSetComponents(Value const& parsee,
-                                                        ComponentMap& hwComponents,
-                                                        std::string const& parentName) {
-        std::list<std::string> siblings;
-        int32_t parent_rel_pos(0);
-
-        if (!parsee.IsArray()) {
-            std::string const name(parseAndSetComponent(parsee, parentName, parsee.MemberBegin(),
-                                                        hwComponents, parent_rel_pos));
-            if (!name.empty()) {
-                siblings.emplace_back(name);
+    // +--ro notification-statistics
+    static void setPluginStatistics(Session& session,
+                                    std::optional<libyang::DataNode>& parent,
+                                    JsonTree::Statistics const& statistics) {
+        std::string const statisticsPath(
+            "/ietf-hardware:hardware/hardware-plugin-augment:plugin-settings/"
+            "notification-statistics");
+        setXpath(session, parent, statisticsPath + "/dropped",
+                 std::to_string(statistics.dropped));
+        setXpath(session, parent, statisticsPath + "/coalesced",
+                 std::to_string(statistics.coalesced));
+    }
+
+    // yang:date-and-time, e.g. 2026-10-17T08:30:00.5+02:00
+    static std::optional<std::chrono::system_clock::time_point>
+        parseDateAndTime(std::string const& dateAndTime) {
+        std::tm tm{};
+        int consumed(0);
+        if (sscanf(dateAndTime.c_str(), "%4d-%2d-%2dT%2d:%2d:%2d%n", &tm.tm_year, &tm.tm_mon,
+                   &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &consumed) != 6) {
+            return std::nullopt;
+        }
+        tm.tm_year -= 1900;
+        tm.tm_mon -= 1;
+        auto time(std::chrono::system_clock::from_time_t(timegm(&tm)));
+
+        char const* rest(dateAndTime.c_str() + consumed);
+        if (*rest == '.') {
+            int64_t fraction(0), scale(1000);
+            for (++rest; *rest >= '0' && *rest <= '9'; ++rest) {
+                if (scale > 1) {
+                    scale /= 10;
+                    fraction += (*rest - '0') * scale;
+                }
             }
-            return siblings;
+            time += std::chrono::milliseconds(fraction);
         }
+        int hours, minutes;
+        if (*rest == 'Z') {
+            return time;
+        } else if ((*rest == '+' || *rest == '-') &&
+                   sscanf(rest + 1, "%2d:%2d", &hours, &minutes) == 2) {
+            std::chrono::minutes const offset(hours * 60 + minutes);
+            return *rest == '+' ? time - offset : time + offset;
+        }
+        return std::nullopt;
+    }
 
-        for (auto& m : parsee.GetArray()) {
-            Value::ConstMemberIterator itr = m.FindMember("id");
-            std::string const name(
-                parseAndSetComponent(m, parentName, itr, hwComponents, parent_rel_pos));
-            if (!name.empty()) {
-                siblings.emplace_back(name);
-            }
+    static std::string formatDateAndTime(int64_t milliseconds) {
+        std::time_t const seconds(milliseconds / 1000);
+        std::tm tm;
+        char timeString[100];
+        if (!gmtime_r(&seconds, &tm) ||
+            !std::strftime(timeString, sizeof(timeString), "%FT%T", &tm)) {
+            return std::string();
         }
-        return siblings;
+        char fraction[8];
+        snprintf(fraction, sizeof(fraction), ".%03dZ", static_cast<int>(milliseconds % 1000));
+        return timeString + std::string(fraction);
     }
 
     static void printCurrentConfig(Session& session, std::string_view module_name) {
@@ -262,13 +381,8 @@ struct Callback {
         }
     }
 
-    static std::unordered_map<std::string, std::string> const& getLSHWtoIETFmap() {
-        static std::unordered_map<std::string, std::string> const _{
-            {"description", "/description"}, {"vendor", "/mfg-name"},
-            {"serial", "/serial-num"},       {"product", "/model-name"},
-            {"version", "/hardware-rev"},    {"handle", "/alias"}};
-        return _;
-    }
+    // set by the first full apply of the configuration
+    static inline std::atomic<bool> configurationApplied{false};
 };
 
 }  // namespace hardware
@@ -12,12 +12,19 @@
 #define COMPONENT_DATA_H
 
 #include <stdint.h>
+#include <utils/fingerprint.h>
 #include <utils/globals.h>
+#include <utils/rapidjson/stringbuffer.h>
+#include <utils/rapidjson/writer.h>
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <set>
 #include <string>
 #include <unordered_map>
 
@@ -28,20 +35,24 @@ struct SensorThreshold;
 
 using ComponentMap = std::unordered_map<std::string, std::shared_ptr<ComponentData>>;
 using ComponentList = std::list<std::shared_ptr<ComponentData>>;
+using ConfigDataList = std::list<std::shared_ptr<ComponentData const>>;
 using SensorThresholdList = std::list<std::shared_ptr<SensorThreshold>>;
+using JsonWriter = rapidjson::Writer<rapidjson::StringBuffer>;
 
 struct SensorThreshold {
 
     SensorThreshold(std::string_view newName)
-        : name(newName), value(0), rising(false), falling(false){};
+        : name(newName), value(0), hysteresis(0), holdTime(0), rising(false), falling(false){};
 
     void printSensorThreshold() {
-        std::cout << "(" << name << ", " << value << ", " << rising << ", " << falling << ")"
-                  << std::endl;
+        std::cout << "(" << name << ", " << value << ", " << hysteresis << ", " << holdTime.count()
+                  << ", " << rising << ", " << falling << ")" << std::endl;
     }
 
     std::string name;
     int32_t value;
+    int32_t hysteresis;
+    std::chrono::seconds holdTime;
     bool rising;
     bool falling;
 };
@@ -61,6 +72,12 @@ struct ComponentData {
                                        bool setPhysicalID = false) const {
         std::string componentPath(mainXpath + "/component[name='" + name + "']");
         logMessage(SR_LL_DBG, "Setting values for component: " + name);
+        // the list instance is created once, its members are created relative to it
+        std::optional<libyang::DataNode> const component(
+            createXpath(session, parent, componentPath));
+        if (!component) {
+            return;
+        }
         // +--rw name              string
         // +--rw class             identityref
         // +--ro physical-index?   int32 {entity-mib}?
@@ -78,59 +95,128 @@ struct ComponentData {
         // +--rw asset-id?         string
         // +--rw uri*              inet:uri
         // +--ro uuid?             yang:uuid
-        setXpath(session, parent, componentPath + "/class", classType);
+        setXpath(component.value(), "class", classType);
 
         if (description) {
-            setXpath(session, parent, componentPath + "/description", description.value());
+            setXpath(component.value(), "description", description.value());
         }
         if (physicalID && setPhysicalID) {
-            setXpath(session, parent, componentPath + "/physical-index",
-                     std::to_string(physicalID.value()));
+            setXpath(component.value(), "physical-index", std::to_string(physicalID.value()));
         }
         if (parentName) {
-            setXpath(session, parent, componentPath + "/parent", parentName.value());
+            setXpath(component.value(), "parent", parentName.value());
         }
         if (parent_rel_pos) {
-            setXpath(session, parent, componentPath + "/parent-rel-pos",
-                     std::to_string(parent_rel_pos.value()));
+            setXpath(component.value(), "parent-rel-pos", std::to_string(parent_rel_pos.value()));
         }
         // childlist to value
         for (auto const& elem : children) {
-            setXpath(session, parent, componentPath + "/contains-child", elem);
+            setXpath(component.value(), "contains-child", elem);
         }
         if (hardwareRev) {
-            setXpath(session, parent, componentPath + "/hardware-rev", hardwareRev.value());
+            setXpath(component.value(), "hardware-rev", hardwareRev.value());
         }
         if (firmwareRev) {
-            setXpath(session, parent, componentPath + "/firmware-rev", firmwareRev.value());
+            setXpath(component.value(), "firmware-rev", firmwareRev.value());
         }
         if (softwareRev) {
-            setXpath(session, parent, componentPath + "/software-rev", softwareRev.value());
+            setXpath(component.value(), "software-rev", softwareRev.value());
         }
         if (serial) {
-            setXpath(session, parent, componentPath + "/serial-num", serial.value());
+            setXpath(component.value(), "serial-num", serial.value());
         }
         if (mfgName) {
-            setXpath(session, parent, componentPath + "/mfg-name", mfgName.value());
+            setXpath(component.value(), "mfg-name", mfgName.value());
         }
         if (modelName) {
-            setXpath(session, parent, componentPath + "/model-name", modelName.value());
+            setXpath(component.value(), "model-name", modelName.value());
         }
         if (alias) {
-            setXpath(session, parent, componentPath + "/alias", alias.value());
+            setXpath(component.value(), "alias", alias.value());
         }
         if (assetID) {
-            setXpath(session, parent, componentPath + "/asset-id", assetID.value());
+            setXpath(component.value(), "asset-id", assetID.value());
         }
         // uri to value
         for (auto const& elem : uri) {
-            setXpath(session, parent, componentPath + "/uri", elem);
+            setXpath(component.value(), "uri", elem);
         }
         if (uuid) {
-            setXpath(session, parent, componentPath + "/uuid", uuid.value());
+            setXpath(component.value(), "uuid", uuid.value());
         }
     }
 
+    // Writes the component as an element of the component list in the JSON encoding of YANG
+    // data (RFC 7951), for building the whole tree with a single parse
+    virtual void writeJson(JsonWriter& writer, bool setPhysicalID = false) const {
+        writer.StartObject();
+        writeJsonMember(writer, "name", name);
+        writeJsonMember(writer, "class", classType);
+        if (description) {
+            writeJsonMember(writer, "description", description.value());
+        }
+        if (physicalID && setPhysicalID) {
+            writer.Key("physical-index");
+            writer.Int(physicalID.value());
+        }
+        if (parentName) {
+            writeJsonMember(writer, "parent", parentName.value());
+        }
+        if (parent_rel_pos) {
+            writer.Key("parent-rel-pos");
+            writer.Int(parent_rel_pos.value());
+        }
+        writeJsonArray(writer, "contains-child", children);
+        if (hardwareRev) {
+            writeJsonMember(writer, "hardware-rev", hardwareRev.value());
+        }
+        if (firmwareRev) {
+            writeJsonMember(writer, "firmware-rev", firmwareRev.value());
+        }
+        if (softwareRev) {
+            writeJsonMember(writer, "software-rev", softwareRev.value());
+        }
+        if (serial) {
+            writeJsonMember(writer, "serial-num", serial.value());
+        }
+        if (mfgName) {
+            writeJsonMember(writer, "mfg-name", mfgName.value());
+        }
+        if (modelName) {
+            writeJsonMember(writer, "model-name", modelName.value());
+        }
+        if (alias) {
+            writeJsonMember(writer, "alias", alias.value());
+        }
+        if (assetID) {
+            writeJsonMember(writer, "asset-id", assetID.value());
+        }
+        writeJsonArray(writer, "uri", uri);
+        if (uuid) {
+            writeJsonMember(writer, "uuid", uuid.value());
+        }
+        writer.EndObject();
+    }
+
+    static void writeJsonMember(JsonWriter& writer, char const* key, std::string const& value) {
+        writer.Key(key);
+        writer.String(value.c_str(), value.size());
+    }
+
+    static void writeJsonArray(JsonWriter& writer,
+                               char const* key,
+                               std::list<std::string> const& values) {
+        if (values.empty()) {
+            return;
+        }
+        writer.Key(key);
+        writer.StartArray();
+        for (auto const& value : values) {
+            writer.String(value.c_str(), value.size());
+        }
+        writer.EndArray();
+    }
+
     void setValueFromLSHWmap(std::string node, std::string value) {
         if (node == "description") {
             description = value;
@@ -215,21 +301,33 @@ struct ComponentData {
             std::cout << std::endl;
         }
         std::cout << "pollinterval: " << pollInterval << std::endl;
+        if (minPollInterval) {
+            std::cout << "minpollinterval: " << minPollInterval.value() << std::endl;
+        }
+        if (maxPollInterval) {
+            std::cout << "maxpollinterval: " << maxPollInterval.value() << std::endl;
+        }
         std::cout << std::endl;
     }
 
-    bool checkForConfigMatch(std::shared_ptr<ComponentData> component) {
-        // We can't compare optionals w/o checking if values are present because of the following
-        // supposition: lhs is considered equal to rhs if, and only if, both lhs and rhs do not
-        // contain a value. Given this we can't have nodes with no 'parents' be considered equal.
-        if (component->parentName && component->parent_rel_pos && parentName && parent_rel_pos) {
-            return (component->classType == classType) && (component->parentName == parentName) &&
-                   (component->parent_rel_pos == parent_rel_pos);
+    // Hash over the component content, used for detecting inventory changes
+    uint64_t fingerprint() const {
+        Fingerprint fp;
+        fp.add(name).add(classType).add(physicalID).add(description).add(parentName);
+        fp.add(parent_rel_pos).add(hardwareRev).add(firmwareRev).add(softwareRev).add(serial);
+        fp.add(mfgName).add(modelName).add(alias).add(assetID).add(uuid);
+        fp.add(static_cast<uint64_t>(children.size()));
+        for (auto const& c : children) {
+            fp.add(c);
         }
-        return false;
+        fp.add(static_cast<uint64_t>(uri.size()));
+        for (auto const& u : uri) {
+            fp.add(u);
+        }
+        return fp.value();
     }
 
-    void replaceWritableValues(std::shared_ptr<ComponentData> component) {
+    void replaceWritableValues(std::shared_ptr<ComponentData const> const& component) {
         name = component->name;
         alias = component->alias;
         assetID = component->assetID;
@@ -251,6 +349,64 @@ struct ComponentData {
         }
     }
 
+    // Published configuration of all components, indexed once for matching discovered
+    // components against it with a single lookup
+    struct ConfigSnapshot {
+
+        ConfigSnapshot(ConfigDataList&& configData) : components(std::move(configData)) {
+            for (auto const& component : components) {
+                // components without a parent can only be matched by name
+                if (component->parentName && component->parent_rel_pos) {
+                    byPosition.insert_or_assign(positionKey(*component), component);
+                }
+                byName.insert_or_assign(component->name, component);
+            }
+        }
+
+        // Configuration of a discovered component, matched by its class and position within
+        // its parent or else by its name
+        std::shared_ptr<ComponentData const> match(ComponentData const& component) const {
+            if (component.parentName && component.parent_rel_pos) {
+                auto const& found = byPosition.find(positionKey(component));
+                if (found != byPosition.end()) {
+                    return found->second;
+                }
+            }
+            auto const& found = byName.find(component.name);
+            return found != byName.end() ? found->second : nullptr;
+        }
+
+        ConfigDataList const components;
+
+    private:
+        struct PositionKey {
+            bool operator==(PositionKey const&) const = default;
+
+            std::string classType;
+            std::string parentName;
+            int32_t parentRelPos;
+        };
+
+        struct PositionKeyHash {
+            size_t operator()(PositionKey const& key) const {
+                return Fingerprint()
+                    .add(key.classType)
+                    .add(key.parentName)
+                    .add(static_cast<uint64_t>(static_cast<uint32_t>(key.parentRelPos)))
+                    .value();
+            }
+        };
+
+        static PositionKey positionKey(ComponentData const& component) {
+            return PositionKey{component.classType, component.parentName.value(),
+                               component.parent_rel_pos.value()};
+        }
+
+        std::unordered_map<PositionKey, std::shared_ptr<ComponentData const>, PositionKeyHash>
+            byPosition;
+        std::unordered_map<std::string, std::shared_ptr<ComponentData const>> byName;
+    };
+
     static void populateConfigData(Session& session, std::string_view module_name) {
         std::string const data_xpath(std::string("/") + std::string(module_name) + ":hardware");
         auto const& data(session.getData(data_xpath));
@@ -258,12 +414,54 @@ struct ComponentData {
             logMessage(SR_LL_ERR, "No data found for population.");
             return;
         }
+        ConfigDataList configData;
+        parseConfigData(data.value(), configData);
+        std::lock_guard lk(hwConfigWriteMtx);
+        hwConfigData.store(std::make_shared<ConfigSnapshot const>(std::move(configData)));
+    }
+
+    // Reads the configuration of the given components again, all other components are kept.
+    // Every component is a datastore read of its own, so beyond CONFIG_UPDATE_COMPONENT_LIMIT
+    // components the whole configuration is read at once instead.
+    static void updateConfigData(Session& session,
+                                 std::string_view module_name,
+                                 std::set<std::string> const& componentNames) {
+        if (componentNames.size() > CONFIG_UPDATE_COMPONENT_LIMIT) {
+            populateConfigData(session, module_name);
+            return;
+        }
+        std::lock_guard lk(hwConfigWriteMtx);
+        auto const previous(hwConfigData.load());
+        ConfigDataList configData(previous ? previous->components : ConfigDataList());
+        configData.remove_if([&componentNames](std::shared_ptr<ComponentData const> const& c) {
+            return c && componentNames.find(c->name) != componentNames.end();
+        });
+        std::string const data_xpath(std::string("/") + std::string(module_name) + ":hardware");
+        for (auto const& name : componentNames) {
+            auto const& data(session.getData(data_xpath + "/component[name='" + name + "']"));
+            if (data) {
+                parseConfigData(data.value(), configData);
+            }
+        }
+        hwConfigData.store(std::make_shared<ConfigSnapshot const>(std::move(configData)));
+    }
+
+    // Configuration of all components. A snapshot is never modified once it has been published,
+    // readers keep using theirs while a new one is swapped in.
+    static std::shared_ptr<ConfigSnapshot const> configData() {
+        auto configData(hwConfigData.load());
+        if (!configData) {
+            configData = std::make_shared<ConfigSnapshot const>(ConfigDataList());
+        }
+        return configData;
+    }
+
+    static void parseConfigData(libyang::DataNode const& data, ConfigDataList& configData) {
         std::shared_ptr<ComponentData> component;
         std::shared_ptr<SensorThreshold> sensThreshold;
         bool isSensorNotification(false);
 
-        hwConfigData.clear();
-        for (libyang::DataNode const& node : data.value().childrenDfs()) {
+        for (libyang::DataNode const& node : data.childrenDfs()) {
             libyang::SchemaNode schema = node.schema();
             switch (schema.nodeType()) {
             case libyang::NodeType::List: {
@@ -282,12 +480,17 @@ struct ComponentData {
                     } else if (component && sensThreshold) {
                         if (std::string(schema.name()) == "value") {
                             sensThreshold->value = std::get<int32_t>(node.asTerm().value());
+                        } else if (std::string(schema.name()) == "hysteresis") {
+                            sensThreshold->hysteresis = std::get<int32_t>(node.asTerm().value());
+                        } else if (std::string(schema.name()) == "hold-time") {
+                            sensThreshold->holdTime =
+                                std::chrono::seconds(std::get<uint32_t>(node.asTerm().value()));
                         }
                     }
                 } else {
                     if (schema.asLeaf().isKey()) {
                         component = std::make_shared<ComponentData>(node.asTerm().valueStr());
-                        hwConfigData.push_back(component);
+                        configData.push_back(component);
                     } else if (component) {
                         if (std::string(schema.name()) == "class") {
                             component->classType = node.asTerm().valueStr();
@@ -304,6 +507,10 @@ struct ComponentData {
                 }
                 if (std::string(schema.name()) == "poll-interval" && component) {
                     component->pollInterval = std::get<uint32_t>(node.asTerm().value());
+                } else if (std::string(schema.name()) == "min-poll-interval" && component) {
+                    component->minPollInterval = std::get<uint32_t>(node.asTerm().value());
+                } else if (std::string(schema.name()) == "max-poll-interval" && component) {
+                    component->maxPollInterval = std::get<uint32_t>(node.asTerm().value());
                 }
                 break;
             }
@@ -339,11 +546,17 @@ struct ComponentData {
     std::list<std::string> uri;
     SensorThresholdList sensorThresholds;
     uint32_t pollInterval;
+    // the poll interval adapts between these bounds when a minimum is configured
+    std::optional<uint32_t> minPollInterval;
+    std::optional<uint32_t> maxPollInterval;
 
-    static ComponentList hwConfigData;
+private:
+    static std::atomic<std::shared_ptr<ConfigSnapshot const>> hwConfigData;
+    static std::mutex hwConfigWriteMtx;
 };
 
-ComponentList ComponentData::hwConfigData;
+std::atomic<std::shared_ptr<ComponentData::ConfigSnapshot const>> ComponentData::hwConfigData;
+std::mutex ComponentData::hwConfigWriteMtx;
 
 }  // namespace hardware
 
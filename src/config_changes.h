@@ -0,0 +1,117 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef CONFIG_CHANGES_H
+#define CONFIG_CHANGES_H
+
+#include <utils/globals.h>
+
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+
+namespace hardware {
+
+// Parts of the configuration touched by an edit, collected from the changes sysrepo reports.
+// Anything that can't be attributed to a component or the plugin settings requires the whole
+// configuration to be applied.
+struct ConfigChanges {
+
+    using Session = sysrepo::Session;
+
+    ConfigChanges() : all(false), settings(false){};
+
+    static ConfigChanges everything() {
+        ConfigChanges changes;
+        changes.all = true;
+        return changes;
+    }
+
+    static ConfigChanges collect(Session& session, std::string_view module_name) {
+        ConfigChanges changes;
+        std::string const changes_xpath("/" + std::string(module_name) + ":*//.");
+        try {
+            for (auto const& change : session.getChanges(changes_xpath)) {
+                logMessage(SR_LL_DBG, operationName(change.operation) + " " + change.node.path());
+                changes.add(change.node);
+            }
+        } catch (std::exception const& e) {
+            logMessage(SR_LL_WRN, "Can't iterate configuration changes: " + std::string(e.what()));
+            changes.all = true;
+        }
+        return changes;
+    }
+
+    // Every component whose configuration has to be read again
+    std::set<std::string> components() const {
+        std::set<std::string> result(inventoryComponents);
+        result.insert(monitoredSensors.begin(), monitoredSensors.end());
+        return result;
+    }
+
+    bool all;
+    bool settings;
+    // components with changed inventory values like alias or asset-id
+    std::set<std::string> inventoryComponents;
+    // components with changed sensor-notifications
+    std::set<std::string> monitoredSensors;
+
+private:
+    void add(libyang::DataNode const& node) {
+        bool const componentNode(std::string(node.schema().name()) == "component");
+        bool sensorNotifications(false);
+        std::optional<std::string> componentName;
+        for (std::optional<libyang::DataNode> n(node); n; n = n->parent()) {
+            std::string const schemaName(n->schema().name());
+            if (schemaName == "plugin-settings") {
+                settings = true;
+                return;
+            }
+            if (schemaName == "sensor-notifications") {
+                sensorNotifications = true;
+            } else if (schemaName == "component") {
+                auto const key(n->findPath("name"));
+                if (key) {
+                    componentName = key->asTerm().valueStr();
+                }
+                break;
+            }
+        }
+        if (!componentName) {
+            all = true;
+            return;
+        }
+        // a created or deleted component affects both
+        if (sensorNotifications || componentNode) {
+            monitoredSensors.insert(componentName.value());
+        }
+        if (!sensorNotifications) {
+            inventoryComponents.insert(componentName.value());
+        }
+    }
+
+    static std::string operationName(sysrepo::ChangeOperation operation) {
+        switch (operation) {
+        case sysrepo::ChangeOperation::Created:
+            return "created";
+        case sysrepo::ChangeOperation::Modified:
+            return "modified";
+        case sysrepo::ChangeOperation::Deleted:
+            return "deleted";
+        default:
+            return "moved";
+        }
+    }
+};
+
+}  // namespace hardware
+
+#endif  // CONFIG_CHANGES_H
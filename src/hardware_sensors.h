@@ -11,14 +11,30 @@
 #ifndef HARDWARE_SENSORS_H
 #define HARDWARE_SENSORS_H
 
+#include <adaptive_poll.h>
+#include <hwmon_reader.h>
+#include <notification_queue.h>
+#include <operational_pusher.h>
+#include <plugin_settings.h>
+#include <request_filter.h>
 #include <sensor_data.h>
+#include <sensor_history.h>
+#include <threshold_state.h>
+#include <timeseries_store.h>
 #include <utils/globals.h>
+#include <utils/timer_wheel.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <list>
 #include <mutex>
+#include <set>
+#include <shared_mutex>
 #include <sysrepo-cpp/Connection.hpp>
 #include <thread>
+#include <vector>
 
 namespace hardware {
 
@@ -32,221 +48,647 @@ struct HardwareSensors {
     }
 
     void injectConnection(Connection conn) {
-        mConn = std::make_shared<Connection>(conn);
+        mNotifications.injectConnection(std::make_shared<Connection>(conn));
     }
 
 private:
-    HardwareSensors() {
+    HardwareSensors()
+        : mSensorIndexValid(false), mSensorReader(PluginSettings::SensorReader::hwmon),
+          mSamplerEpoch(std::chrono::steady_clock::now()), mRearmed(false), mStop(false) {
         if (sensors_init(nullptr) != 0) {
             throw SensorsInitFail();
         }
     }
 
-    void checkAndTriggerNotification(std::string const& componentName,
-                                     std::shared_ptr<SensorThreshold> sensThr,
-                                     int32_t sensorValue) {
-        logMessage(SR_LL_INF, "Sensor threshold triggered for: " + componentName + " value " +
-                                  std::to_string(sensorValue) + ". Sending Notification...");
+    // Only transitions of a threshold are notified, not every sample on one side of it
+    void evaluateThresholds(std::string const& componentName,
+                            ComponentData const& config,
+                            int32_t sensorValue,
+                            ThresholdState::Clock::time_point now) {
+        auto& states = mThresholdStates[componentName];
+        for (auto const& sensThr : config.sensorThresholds) {
+            auto state = states.find(sensThr->name);
+            if (state == states.end() || !state->second.matches(*sensThr)) {
+                state = states.insert_or_assign(sensThr->name, ThresholdState(*sensThr)).first;
+            }
+            std::optional<ThresholdState::Crossing> const crossing(
+                state->second.evaluate(sensorValue, now));
+            if (!crossing) {
+                continue;
+            }
+            mNotifications.enqueue(NotificationEvent{
+                componentName, sensThr, sensorValue,
+                crossing.value() == ThresholdState::Crossing::rising, state->second.pending});
+        }
+    }
+
+    // Forgets the state of thresholds and adaptive intervals that aren't configured anymore
+    void pruneThresholdStates() {
+        for (auto state = mAdaptivePollStates.begin(); state != mAdaptivePollStates.end();) {
+            auto const& sensor = mSampledSensors.find(state->first);
+            bool const adaptive(sensor != mSampledSensors.end() &&
+                                sensor->second.minIntervalTicks != 0);
+            state = adaptive ? std::next(state) : mAdaptivePollStates.erase(state);
+        }
+        for (auto component = mThresholdStates.begin(); component != mThresholdStates.end();) {
+            auto const& sensor = mSampledSensors.find(component->first);
+            if (sensor == mSampledSensors.end() || !sensor->second.config) {
+                component = mThresholdStates.erase(component);
+                continue;
+            }
+            auto& states = component->second;
+            for (auto state = states.begin(); state != states.end();) {
+                auto const& thresholds = sensor->second.config->sensorThresholds;
+                bool const configured(
+                    std::find_if(thresholds.begin(), thresholds.end(), [&state](auto const& t) {
+                        return t->name == state->first;
+                    }) != thresholds.end());
+                state = configured ? std::next(state) : states.erase(state);
+            }
+            ++component;
+        }
+    }
+
+    struct SampledSensor {
+        // the longest interval of a sensor whose interval adapts
+        uint64_t intervalTicks;
+        // 0 if the interval doesn't adapt
+        uint64_t minIntervalTicks;
+        // configuration of a monitored sensor, null for sensors that are only sampled
+        std::shared_ptr<ComponentData const> config;
+    };
+
+    using DueList = std::vector<std::pair<std::string, std::shared_ptr<ComponentData const>>>;
+
+    uint64_t currentTick() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - mSamplerEpoch)
+                   .count() /
+               SAMPLER_TICK_MS;
+    }
+
+    std::chrono::steady_clock::time_point tickToTime(uint64_t tick) const {
+        return mSamplerEpoch + std::chrono::milliseconds(tick * SAMPLER_TICK_MS);
+    }
 
-        std::string notifPath("/ietf-hardware:hardware/component[name='");
-        notifPath += componentName + "']/sensor-notifications-augment:sensor-threshold-crossed";
+    static uint64_t intervalToTicks(std::chrono::seconds interval) {
+        return std::max<uint64_t>(
+            1, std::chrono::duration_cast<std::chrono::milliseconds>(interval).count() /
+                   SAMPLER_TICK_MS);
+    }
 
-        /* start session */
-        if (!mConn) {
+    // Bounds of the poll interval of a monitored sensor, the minimum is 0 if it doesn't adapt
+    static std::pair<uint64_t, uint64_t> pollIntervalTicks(ComponentData const& config) {
+        if (!config.minPollInterval) {
+            return {0, intervalToTicks(std::chrono::seconds(config.pollInterval))};
+        }
+        uint64_t const minTicks(
+            intervalToTicks(std::chrono::seconds(config.minPollInterval.value())));
+        uint64_t const maxTicks(intervalToTicks(
+            std::chrono::seconds(config.maxPollInterval.value_or(config.pollInterval))));
+        return {minTicks, std::max(minTicks, maxTicks)};
+    }
+
+    // Next interval of a sensor whose interval adapts to its latest value
+    void adaptInterval(std::string const& componentName,
+                       ComponentData const& config,
+                       int32_t sensorValue,
+                       AdaptivePollState::Clock::time_point now) {
+        if (!config.minPollInterval) {
             return;
         }
-        auto sess = mConn->sessionStart();
+        auto const [minTicks, maxTicks] = pollIntervalTicks(config);
+        auto state = mAdaptivePollStates.find(componentName);
+        if (state == mAdaptivePollStates.end() || !state->second.matches(minTicks, maxTicks)) {
+            state = mAdaptivePollStates
+                        .insert_or_assign(componentName, AdaptivePollState(minTicks, maxTicks))
+                        .first;
+        }
+        state->second.update(sensorValue, now, config.sensorThresholds);
+    }
 
-        auto input = sess.getContext().newPath((notifPath + "/threshold-name"), sensThr->name);
-        input.newPath((notifPath + "/threshold-value"), std::to_string(sensThr->value));
-        if (sensorValue > sensThr->value) {
-            input.newPath((notifPath + "/rising"), std::nullopt);
-        } else {
-            input.newPath((notifPath + "/falling"), std::nullopt);
+    // Reads all due sensors in one pass, publishes the values to the sample table together and
+    // evaluates the thresholds of monitored sensors against them
+    void sampleBatch(DueList const& due) {
+        std::vector<std::optional<int32_t>> values;
+        values.reserve(due.size());
+        {
+            // the index is only locked to resolve the sensors, requests aren't held up by the
+            // reads, while rescanning has to wait for them
+            std::shared_lock readLk(mSensorReadMtx);
+            std::vector<std::optional<Sensor::Descriptor>> descriptors;
+            descriptors.reserve(due.size());
+            {
+                std::lock_guard lk(mSensorDataMtx);
+                buildSensorIndex();
+                for (auto const& [name, _] : due) {
+                    auto const& descriptor = mSensorIndex.find(name);
+                    descriptors.emplace_back(descriptor == mSensorIndex.end()
+                                                 ? std::nullopt
+                                                 : std::make_optional(descriptor->second));
+                }
+            }
+            for (auto const& descriptor : descriptors) {
+                values.emplace_back(descriptor ? readSensor(descriptor.value()) : std::nullopt);
+            }
+        }
+        auto const timestamp(std::chrono::system_clock::now());
+        {
+            std::lock_guard lk(mSampleTableMtx);
+            for (size_t i = 0; i < due.size(); ++i) {
+                if (values[i]) {
+                    mSamples.insert_or_assign(due[i].first,
+                                              SensorSample{values[i].value(), timestamp});
+                    mHistory.record(due[i].first, values[i].value(), timestamp);
+                }
+            }
+        }
+        if (OperationalPusher::getInstance().running()) {
+            std::vector<std::string> sampled;
+            for (size_t i = 0; i < due.size(); ++i) {
+                if (values[i]) {
+                    sampled.push_back(due[i].first);
+                }
+            }
+            OperationalPusher::getInstance().notifySamples(sampled);
+        }
+        for (size_t i = 0; i < due.size(); ++i) {
+            if (values[i]) {
+                mStore.append(due[i].first, timestamp, values[i].value());
+            }
         }
 
-        input.newPath((notifPath + "/sensor-value"), std::to_string(sensorValue));
+        auto const now(ThresholdState::Clock::now());
+        for (size_t i = 0; i < due.size(); ++i) {
+            if (values[i] && due[i].second) {
+                evaluateThresholds(due[i].first, *due[i].second, values[i].value(), now);
+                adaptInterval(due[i].first, *due[i].second, values[i].value(), now);
+            }
+        }
+    }
 
-        sess.sendNotification(input, sysrepo::Wait::No);
+    // Sensors that keep their interval keep their deadline, new ones are sampled right away
+    void arm(std::string const& name, SampledSensor const& sensor, uint64_t now) {
+        auto const& previous = mSampledSensors.find(name);
+        if (previous == mSampledSensors.end() ||
+            previous->second.minIntervalTicks != sensor.minIntervalTicks) {
+            mTimerWheel.schedule(name, now);
+        } else if (previous->second.intervalTicks != sensor.intervalTicks ||
+                   !mTimerWheel.contains(name)) {
+            mTimerWheel.schedule(name, now + sensor.intervalTicks);
+        }
     }
 
-    void runFunc(std::shared_ptr<ComponentData> component) {
-        // TSAN falsely reports double lock on the mutex here for some compiler versions
-        std::unique_lock<std::mutex> lk(mNotificationMtx);
-        while (mCV.wait_for(lk, std::chrono::seconds(component->pollInterval)) ==
-               std::cv_status::timeout) {
-            std::optional<int32_t> value = getValue(component->name);
-            if (!value) {
+    // Re-arms a timer one interval after its previous deadline, skipping missed deadlines
+    void rearm(std::string const& name, uint64_t deadline, uint64_t interval) {
+        uint64_t nextDeadline(deadline + interval);
+        while (nextDeadline <= mTimerWheel.currentTick()) {
+            nextDeadline += interval;
+        }
+        mTimerWheel.schedule(name, nextDeadline);
+    }
+
+    // Sleeps until the earliest deadline, samples every sensor whose timer expired and re-arms
+    // it relative to its previous deadline so that sampling doesn't drift. Sensors whose interval
+    // adapts are re-armed once their new value is known.
+    void runFunc() {
+        std::vector<std::pair<std::string, uint64_t>> expired;
+        std::vector<std::pair<std::string, uint64_t>> adaptive;
+        DueList due;
+        std::unique_lock<std::mutex> lk(mSamplerMtx);
+        while (!mStop) {
+            std::optional<uint64_t> const next(mTimerWheel.nextDeadline());
+            auto const wakeUp = [this] { return mStop || mRearmed; };
+            if (next) {
+                mSamplerCV.wait_until(lk, tickToTime(next.value()), wakeUp);
+            } else {
+                mSamplerCV.wait(lk, wakeUp);
+            }
+            if (mRearmed) {
+                pruneThresholdStates();
+                mRearmed = false;
+            }
+
+            expired.clear();
+            adaptive.clear();
+            due.clear();
+            mTimerWheel.advance(currentTick(), expired);
+            for (auto const& [name, deadline] : expired) {
+                auto const& sensor = mSampledSensors.find(name);
+                if (sensor == mSampledSensors.end()) {
+                    continue;
+                }
+                if (sensor->second.minIntervalTicks) {
+                    adaptive.emplace_back(name, deadline);
+                } else {
+                    rearm(name, deadline, sensor->second.intervalTicks);
+                }
+                due.emplace_back(name, sensor->second.config);
+            }
+            if (due.empty()) {
                 continue;
             }
-            for (auto const& sensThr : component->sensorThresholds) {
-                try {
-                    checkAndTriggerNotification(component->name, sensThr, value.value());
-                } catch (std::exception& ex) {
-                    logMessage(SR_LL_WRN, "Sending notification failed: " + std::string(ex.what()));
+
+            lk.unlock();
+            sampleBatch(due);
+            lk.lock();
+
+            for (auto const& [name, deadline] : adaptive) {
+                auto const& sensor = mSampledSensors.find(name);
+                // a reconfiguration in the meantime has armed the timer already
+                if (sensor == mSampledSensors.end() || mTimerWheel.contains(name)) {
+                    continue;
                 }
+                auto const& state = mAdaptivePollStates.find(name);
+                rearm(name, deadline,
+                      state != mAdaptivePollStates.end() ? state->second.intervalTicks
+                                                         : sensor->second.intervalTicks);
             }
         }
-        logMessage(SR_LL_DBG, "Thread for component: " + component->name + " ended.");
+        logMessage(SR_LL_DBG, "Sensor sampler ended.");
     }
 
 public:
+    struct SensorSample {
+        int32_t value;
+        std::chrono::system_clock::time_point timestamp;
+    };
+
+    using SampleTable = std::unordered_map<std::string, SensorSample>;
+
     HardwareSensors(HardwareSensors const&) = delete;
     void operator=(HardwareSensors const&) = delete;
 
     ~HardwareSensors() {
-        notifyAndJoin();
+        stopSampler();
+        mStore.close();
         sensors_cleanup();
     }
 
-    void notify() {
-        mCV.notify_all();
+    void startSampler() {
+        std::lock_guard lk(mSamplerMtx);
+        if (mSampler.joinable()) {
+            return;
+        }
+        mNotifications.start();
+        mStop = false;
+        mSampler = std::thread(&HardwareSensors::runFunc, this);
     }
 
-    void notifyAndJoin() {
-        mCV.notify_all();
-        stopThreads();
+    void stopSampler() {
+        {
+            std::lock_guard lk(mSamplerMtx);
+            mStop = true;
+        }
+        mSamplerCV.notify_all();
+        if (mSampler.joinable()) {
+            mSampler.join();
+        }
+        mNotifications.stop();
     }
 
-    void stopThreads() {
-        int32_t numThreadsStopped(0);
-        for (auto& [_, thread] : mThreads) {
-            if (thread.joinable()) {
-                thread.join();
-                numThreadsStopped++;
+    // Arms a timer for every detected sensor. Monitored sensors are sampled at their poll
+    // interval, all others at the given sample interval. Sensors that keep their interval keep
+    // their deadline, new ones are sampled right away and removed ones are cancelled.
+    void reconfigure(std::chrono::seconds sampleInterval,
+                     PluginSettings::NotificationOverflow overflow,
+                     std::vector<std::chrono::seconds> const& historyWindows) {
+        mNotifications.setOverflowPolicy(overflow);
+        mNotifications.invalidateTemplates();
+
+        std::unordered_map<std::string, SampledSensor> sampled;
+        std::list<std::string> sensorNames;
+        {
+            std::lock_guard lk(mSensorDataMtx);
+            buildSensorIndex();
+            for (auto const& [name, _] : mSensorIndex) {
+                sampled[name] = SampledSensor{intervalToTicks(sampleInterval), 0, nullptr};
+                sensorNames.push_back(name);
             }
         }
-        logMessage(SR_LL_DBG, std::to_string(numThreadsStopped) + " threads stopped, out of: " +
-                                  std::to_string(mThreads.size()) + " started.");
-        mThreads.clear();
+        mHistory.configure(sensorNames, historyWindows);
+        for (auto const& configData : ComponentData::configData()->components) {
+            if (configData && !configData->sensorThresholds.empty()) {
+                auto const [minTicks, maxTicks] = pollIntervalTicks(*configData);
+                sampled[configData->name] = SampledSensor{maxTicks, minTicks, configData};
+            }
+        }
+
+        {
+            std::lock_guard lk(mSamplerMtx);
+            uint64_t const now(currentTick());
+            for (auto const& [name, sensor] : sampled) {
+                arm(name, sensor, now);
+            }
+            for (auto const& [name, _] : mSampledSensors) {
+                if (sampled.find(name) == sampled.end()) {
+                    mTimerWheel.cancel(name);
+                }
+            }
+            mSampledSensors = std::move(sampled);
+            mRearmed = true;
+            logMessage(SR_LL_DBG, std::to_string(mSampledSensors.size()) +
+                                      " sensors armed for sampling.");
+        }
+        mSamplerCV.notify_all();
+
+        // samples of sensors that are gone must not be served anymore
+        std::lock_guard lk(mSampleTableMtx);
+        std::lock_guard samplerLk(mSamplerMtx);
+        std::erase_if(mSamples, [this](auto const& sample) {
+            return mSampledSensors.find(sample.first) == mSampledSensors.end();
+        });
     }
 
-    void startThreads() {
-        for (auto const& configData : ComponentData::hwConfigData) {
-            if (configData && !configData->sensorThresholds.empty()) {
-                logMessage(SR_LL_DBG, "Starting thread for component: " + configData->name + ".");
-                mThreads[configData->name] =
-                    std::thread(&HardwareSensors::runFunc, this, configData);
+    // Samples are persisted while the store is open
+    void configureStore(bool enabled, std::chrono::hours retention) {
+        if (enabled) {
+            mStore.open(TIMESERIES_LOCATION, retention);
+        } else {
+            mStore.close();
+        }
+    }
+
+    // Persisted samples of the given sensors, or of all sensors if none are given
+    std::map<std::string, TimeSeriesStore::Samples>
+        querySamples(std::set<std::string> const& sensorNames,
+                     std::chrono::system_clock::time_point from,
+                     std::chrono::system_clock::time_point to) const {
+        return mStore.query(sensorNames, from, to);
+    }
+
+    // Applies the configuration of the given components only. All other sensors keep their
+    // timers and threshold states.
+    void updateMonitoredSensors(std::set<std::string> const& componentNames,
+                                std::chrono::seconds sampleInterval) {
+        mNotifications.invalidateTemplates();
+
+        std::unordered_map<std::string, std::optional<SampledSensor>> updated;
+        {
+            std::lock_guard lk(mSensorDataMtx);
+            buildSensorIndex();
+            for (auto const& name : componentNames) {
+                if (mSensorIndex.find(name) != mSensorIndex.end()) {
+                    updated[name] = SampledSensor{intervalToTicks(sampleInterval), 0, nullptr};
+                } else {
+                    updated[name] = std::nullopt;
+                }
+            }
+        }
+        for (auto const& configData : ComponentData::configData()->components) {
+            if (configData && !configData->sensorThresholds.empty() &&
+                componentNames.find(configData->name) != componentNames.end()) {
+                auto const [minTicks, maxTicks] = pollIntervalTicks(*configData);
+                updated[configData->name] = SampledSensor{maxTicks, minTicks, configData};
+            }
+        }
+
+        {
+            std::lock_guard lk(mSamplerMtx);
+            uint64_t const now(currentTick());
+            for (auto const& [name, sensor] : updated) {
+                if (sensor) {
+                    arm(name, sensor.value(), now);
+                    mSampledSensors.insert_or_assign(name, sensor.value());
+                } else {
+                    mTimerWheel.cancel(name);
+                    mSampledSensors.erase(name);
+                }
             }
+            mRearmed = true;
+            logMessage(SR_LL_DBG, std::to_string(updated.size()) + " sensors re-armed.");
         }
+        mSamplerCV.notify_all();
+    }
+
+    uint64_t droppedNotifications() const {
+        return mNotifications.dropped();
     }
 
-    std::optional<int32_t> getValue(std::string const& sensorName) {
+    uint64_t coalescedNotifications() const {
+        return mNotifications.coalesced();
+    }
+
+    // Drops the sensor index, chips are detected again on the next access
+    void rescan(PluginSettings::SensorReader reader) {
+        // descriptors being read refer to the chips and channels released here
+        std::unique_lock readLk(mSensorReadMtx);
         std::lock_guard lk(mSensorDataMtx);
-        sensors_chip_name const* cn = nullptr;
-        int c = 0;
-        std::optional<int32_t> value;
-        while ((cn = sensors_get_detected_chips(0, &c))) {
-            sensors_feature const* feature = nullptr;
-            int f = 0;
-            while ((feature = sensors_get_features(cn, &f))) {
-                if (sensorName != (std::string(cn->prefix) + "/" + feature->name)) {
-                    break;
+        mSensorIndex.clear();
+        mSensorIndexValid = false;
+        mHwmon.clear();
+        mSensorReader = reader;
+        sensors_cleanup();
+        if (sensors_init(nullptr) != 0) {
+            logMessage(SR_LL_ERR, "sensors_init() failure on rescan");
+        }
+    }
+
+    // Sensor values come from the sample table, a sensor is only read directly if it hasn't been
+    // sampled yet
+    void parseSensorData(ComponentMap& hwComponents,
+                         RequestFilter const& filter,
+                         bool withHistory = false) {
+        std::shared_lock readLk(mSensorReadMtx);
+        std::vector<std::pair<std::string, Sensor::Descriptor>> selected;
+        {
+            std::lock_guard lk(mSensorDataMtx);
+            buildSensorIndex();
+            if (filter.componentName) {
+                auto const& descriptor = mSensorIndex.find(filter.componentName.value());
+                if (descriptor != mSensorIndex.end()) {
+                    selected.emplace_back(*descriptor);
                 }
-                switch (feature->type) {
-                case SENSORS_FEATURE_IN:
-                    value =
-                        Sensor::getValueFromSubfeature(cn, feature, SENSORS_SUBFEATURE_IN_INPUT, 3);
-                    break;
-                case SENSORS_FEATURE_CURR:
-                    value = Sensor::getValueFromSubfeature(cn, feature,
-                                                           SENSORS_SUBFEATURE_CURR_INPUT, 3);
-                    break;
-                case SENSORS_FEATURE_TEMP:
-                    value = Sensor::getValueFromSubfeature(cn, feature,
-                                                           SENSORS_SUBFEATURE_TEMP_INPUT, 0);
-                    break;
-                case SENSORS_FEATURE_FAN:
-                    value = Sensor::getValueFromSubfeature(cn, feature,
-                                                           SENSORS_SUBFEATURE_FAN_INPUT, 0);
-                    break;
-                case SENSORS_FEATURE_POWER:
-                    value = Sensor::getValueFromSubfeature(cn, feature,
-                                                           SENSORS_SUBFEATURE_POWER_INPUT, 0);
-                    break;
-                case SENSORS_FEATURE_HUMIDITY:
-                    value = Sensor::getValueFromSubfeature(cn, feature,
-                                                           SENSORS_SUBFEATURE_HUMIDITY_INPUT, 0);
-                    break;
-                default:
-                    break;
+            } else {
+                selected.assign(mSensorIndex.begin(), mSensorIndex.end());
+            }
+        }
+        std::vector<std::optional<SensorSample>> const samples(latestSamples(selected));
+
+        auto const now(std::chrono::system_clock::now());
+        for (size_t i = 0; i < selected.size(); ++i) {
+            auto const& [name, descriptor] = selected[i];
+            if (samples[i]) {
+                hwComponents.emplace(
+                    name, sampledSensor(name, descriptor, samples[i], withHistory, now));
+                continue;
+            }
+            std::optional<int32_t> value = readSensor(descriptor);
+            if (!value) {
+                continue;
+            }
+            auto sensor(sampledSensor(name, descriptor, std::nullopt, withHistory, now));
+            sensor->value = value.value();
+            hwComponents.emplace(name, sensor);
+        }
+        for (auto const& configData : ComponentData::configData()->components) {
+            if (configData) {
+                auto const& component = hwComponents.find(configData->name);
+                if (component != hwComponents.end() &&
+                    component->second->classType == "iana-hardware:sensor") {
+                    component->second->sensorThresholds = configData->sensorThresholds;
+                    component->second->pollInterval = configData->pollInterval;
+                    component->second->minPollInterval = configData->minPollInterval;
+                    component->second->maxPollInterval = configData->maxPollInterval;
                 }
+            }
+        }
+    }
 
-                if (value) {
-                    return value;
+    // Sensors with the given names as of their latest samples, without their thresholds, for
+    // changing the sensor leaves of an already built tree. Sensors not sampled yet are left out.
+    ComponentMap sampledSensors(std::set<std::string> const& sensorNames, bool withHistory) {
+        std::vector<std::pair<std::string, Sensor::Descriptor>> selected;
+        {
+            std::lock_guard lk(mSensorDataMtx);
+            buildSensorIndex();
+            for (auto const& name : sensorNames) {
+                auto const& descriptor = mSensorIndex.find(name);
+                if (descriptor != mSensorIndex.end()) {
+                    selected.emplace_back(*descriptor);
                 }
             }
         }
-        return value;
+        std::vector<std::optional<SensorSample>> const samples(latestSamples(selected));
+
+        ComponentMap hwComponents;
+        auto const now(std::chrono::system_clock::now());
+        for (size_t i = 0; i < selected.size(); ++i) {
+            if (samples[i]) {
+                hwComponents.emplace(selected[i].first,
+                                     sampledSensor(selected[i].first, selected[i].second,
+                                                   samples[i], withHistory, now));
+            }
+        }
+        return hwComponents;
     }
 
-    void parseSensorData(ComponentMap& hwComponents) {
-        std::lock_guard lk(mSensorDataMtx);
+private:
+    std::vector<std::optional<SensorSample>>
+        latestSamples(std::vector<std::pair<std::string, Sensor::Descriptor>> const& sensors) {
+        std::vector<std::optional<SensorSample>> samples;
+        samples.reserve(sensors.size());
+        std::lock_guard lk(mSampleTableMtx);
+        for (auto const& [name, _] : sensors) {
+            auto const& sample = mSamples.find(name);
+            samples.emplace_back(sample == mSamples.end() ? std::nullopt
+                                                          : std::make_optional(sample->second));
+        }
+        return samples;
+    }
+
+    std::shared_ptr<Sensor> sampledSensor(std::string const& name,
+                                          Sensor::Descriptor const& descriptor,
+                                          std::optional<SensorSample> const& sample,
+                                          bool withHistory,
+                                          std::chrono::system_clock::time_point now) {
+        auto sensor(std::make_shared<Sensor>(name));
+        if (sample) {
+            sensor->value = sample->value;
+            sensor->valueTimestamp = std::chrono::system_clock::to_time_t(sample->timestamp);
+        }
+        sensor->valueType = descriptor.valueType;
+        sensor->valuePrecision = descriptor.valuePrecision;
+        if (withHistory) {
+            sensor->history = mHistory.aggregate(name, now);
+        }
+        return sensor;
+    }
+
+    // Sensors with an opened hwmon attribute are read directly, libsensors is the fallback
+    std::optional<int32_t> readSensor(Sensor::Descriptor const& descriptor) {
+        if (descriptor.hwmon) {
+            std::optional<int32_t> value(mHwmon.read(*descriptor.hwmon));
+            if (value) {
+                return value;
+            }
+        }
+        return Sensor::getValueFromDescriptor(descriptor);
+    }
+
+    // libsensors applies the compute statements of its configuration, which a raw hwmon value
+    // misses. The libsensors value is read between two hwmon reads, so a changing value still
+    // matches. If libsensors can't read the sensor at all the hwmon attribute is kept.
+    bool hwmonMatchesLibsensors(Sensor::Descriptor const& descriptor) const {
+        std::optional<int32_t> const before(mHwmon.read(*descriptor.hwmon));
+        std::optional<int32_t> const value(Sensor::getValueFromDescriptor(descriptor));
+        std::optional<int32_t> const after(mHwmon.read(*descriptor.hwmon));
+        if (!before || !after) {
+            return false;
+        }
+        if (!value) {
+            return true;
+        }
+        auto const [low, high] = std::minmax(before.value(), after.value());
+        // the scaled floating point value of libsensors may be truncated by one
+        return value.value() >= low - 1 && value.value() <= high + 1;
+    }
+
+    // Resolves every readable sensor once, lookups by name don't have to walk the chips
+    void buildSensorIndex() {
+        if (mSensorIndexValid) {
+            return;
+        }
+        if (mSensorReader == PluginSettings::SensorReader::hwmon) {
+            mHwmon.discover();
+        }
         sensors_chip_name const* cn = nullptr;
         int c = 0;
         while ((cn = sensors_get_detected_chips(0, &c))) {
             sensors_feature const* feature = nullptr;
             int f = 0;
             while ((feature = sensors_get_features(cn, &f))) {
-                Sensor tempSensor(std::string(cn->prefix) + "/" + feature->name);
-                bool result(false);
-                switch (feature->type) {
-                case SENSORS_FEATURE_IN:
-                    tempSensor.valueType = Sensor::ValueType::volts_dc;
-                    tempSensor.valuePrecision = 3;
-                    result = tempSensor.setValueFromSubfeature(
-                        cn, feature, SENSORS_SUBFEATURE_IN_INPUT, tempSensor.valuePrecision);
-                    break;
-                case SENSORS_FEATURE_CURR:
-                    tempSensor.valueType = Sensor::ValueType::amperes;
-                    tempSensor.valuePrecision = 3;
-                    result = tempSensor.setValueFromSubfeature(
-                        cn, feature, SENSORS_SUBFEATURE_CURR_INPUT, tempSensor.valuePrecision);
-                    break;
-                case SENSORS_FEATURE_TEMP:
-                    tempSensor.valueType = Sensor::ValueType::celsius;
-                    result = tempSensor.setValueFromSubfeature(
-                        cn, feature, SENSORS_SUBFEATURE_TEMP_INPUT, tempSensor.valuePrecision);
-                    break;
-                case SENSORS_FEATURE_FAN:
-                    tempSensor.valueType = Sensor::ValueType::rpm;
-                    result = tempSensor.setValueFromSubfeature(
-                        cn, feature, SENSORS_SUBFEATURE_FAN_INPUT, tempSensor.valuePrecision);
-                    break;
-                case SENSORS_FEATURE_POWER:
-                    tempSensor.valueType = Sensor::ValueType::watts;
-                    result = tempSensor.setValueFromSubfeature(
-                        cn, feature, SENSORS_SUBFEATURE_POWER_INPUT, tempSensor.valuePrecision);
-                    break;
-                case SENSORS_FEATURE_HUMIDITY:
-                    tempSensor.valueType = Sensor::ValueType::percent_rh;
-                    result = tempSensor.setValueFromSubfeature(
-                        cn, feature, SENSORS_SUBFEATURE_HUMIDITY_INPUT, tempSensor.valuePrecision);
-                    break;
-                default:
-                    tempSensor.valueType = Sensor::ValueType::other;
-                    break;
+                std::optional<Sensor::Descriptor> descriptor = Sensor::describeFeature(cn, feature);
+                if (!descriptor) {
+                    continue;
                 }
-                if (result) {
-                    hwComponents.emplace(std::string(tempSensor.name),
-                                         std::make_shared<Sensor>(tempSensor));
+                // the hwmon attribute is resolved against the chip of the descriptor itself
+                descriptor->hwmon = mHwmon.find(cn->path, feature->name);
+                std::string const name(std::string(cn->prefix) + "/" + feature->name);
+                if (descriptor->hwmon && !hwmonMatchesLibsensors(descriptor.value())) {
+                    logMessage(SR_LL_DBG, "Sensor " + name +
+                                              " differs from its hwmon attribute, it is read "
+                                              "through libsensors.");
+                    descriptor->hwmon = nullptr;
+                }
+                if (!mSensorIndex.emplace(name, descriptor.value()).second) {
+                    logMessage(SR_LL_WRN, "Sensor " + name + " of " +
+                                              std::string(cn->path ? cn->path : "unknown chip") +
+                                              " has the name of another sensor, it is ignored.");
                 }
             }
         }
-        for (auto const& configData : ComponentData::hwConfigData) {
-            if (configData) {
-                auto const& component = hwComponents.find(configData->name);
-                component->second->sensorThresholds = configData->sensorThresholds;
-            }
-        }
+        mSensorIndexValid = true;
+        logMessage(SR_LL_DBG, "Sensor index built with " + std::to_string(mSensorIndex.size()) +
+                                  " sensors.");
     }
 
-private:
-    std::shared_ptr<Connection> mConn;
-    std::mutex mNotificationMtx;
-    std::condition_variable mCV;
+    // held shared while sensors are read, exclusively while the chips are released
+    std::shared_mutex mSensorReadMtx;
     std::mutex mSensorDataMtx;
-    std::unordered_map<std::string, std::thread> mThreads;
+    std::unordered_map<std::string, Sensor::Descriptor> mSensorIndex;
+    bool mSensorIndexValid;
+    PluginSettings::SensorReader mSensorReader;
+    HwmonReader mHwmon;
+    std::mutex mSamplerMtx;
+    std::condition_variable mSamplerCV;
+    std::thread mSampler;
+    std::chrono::steady_clock::time_point const mSamplerEpoch;
+    TimerWheel<std::string> mTimerWheel;
+    std::unordered_map<std::string, SampledSensor> mSampledSensors;
+    std::mutex mSampleTableMtx;
+    // latest value of every sampled sensor, updated in place by each batch
+    SampleTable mSamples;
+    // owned by the sampler thread
+    std::unordered_map<std::string, std::unordered_map<std::string, ThresholdState>>
+        mThresholdStates;
+    // owned by the sampler thread
+    std::unordered_map<std::string, AdaptivePollState> mAdaptivePollStates;
+    NotificationQueue mNotifications;
+    SensorHistory mHistory;
+    TimeSeriesStore mStore;
+    bool mRearmed;
+    bool mStop;
 };
 
 }  // namespace hardware
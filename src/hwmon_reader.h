@@ -0,0 +1,176 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef HWMON_READER_H
+#define HWMON_READER_H
+
+#include <utils/globals.h>
+
+#include <array>
+#include <charconv>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace hardware {
+
+// An opened hwmon input attribute, raw values are divided by the divisor to get the sensor
+// value in the same unit and precision as the one read through libsensors
+struct HwmonChannel {
+    int fd;
+    int64_t divisor;
+};
+
+// Reads hwmon sensors straight from sysfs. Every input attribute is opened once on discovery and
+// read with a single pread() afterwards, whereas libsensors opens, reads and closes the attribute
+// on every access.
+struct HwmonReader {
+
+    using Path = std::filesystem::path;
+
+    HwmonReader() = default;
+
+    HwmonReader(HwmonReader const&) = delete;
+    void operator=(HwmonReader const&) = delete;
+
+    ~HwmonReader() {
+        clear();
+    }
+
+    // Channels are keyed by the sysfs directory of their chip and the feature, e.g.
+    // /sys/devices/platform/coretemp.0/hwmon/hwmon2/temp1. Chips of the same driver share their
+    // name, only the directory tells them apart.
+    void discover() {
+        clear();
+        std::error_code ec;
+        for (auto const& entry : std::filesystem::directory_iterator(SYSFS_HWMON_LOCATION, ec)) {
+            Path directory(entry.path());
+            if (!readName(directory / "name")) {
+                // older drivers keep their attributes on the device
+                directory /= "device";
+                if (!readName(directory / "name")) {
+                    continue;
+                }
+            }
+            std::optional<Path> const chipPath(canonicalPath(directory));
+            if (!chipPath) {
+                continue;
+            }
+            for (auto const& attribute : std::filesystem::directory_iterator(directory, ec)) {
+                std::string const fileName(attribute.path().filename());
+                std::optional<int64_t> divisor(inputDivisor(fileName));
+                if (!divisor) {
+                    continue;
+                }
+                int const fd(open(attribute.path().c_str(), O_RDONLY | O_CLOEXEC));
+                if (fd < 0) {
+                    continue;
+                }
+                std::string const feature(
+                    fileName.substr(0, fileName.size() - INPUT_SUFFIX.size()));
+                mChannels.emplace((chipPath.value() / feature).string(),
+                                  HwmonChannel{fd, divisor.value()});
+            }
+        }
+        logMessage(SR_LL_DBG, std::to_string(mChannels.size()) + " hwmon channels opened.");
+    }
+
+    void clear() {
+        for (auto const& [_, channel] : mChannels) {
+            close(channel.fd);
+        }
+        mChannels.clear();
+    }
+
+    // Channel of a feature of the chip libsensors found in the given sysfs directory
+    HwmonChannel const* find(char const* chipPath, std::string const& feature) const {
+        if (!chipPath) {
+            return nullptr;
+        }
+        std::optional<Path> const directory(canonicalPath(chipPath));
+        if (!directory) {
+            return nullptr;
+        }
+        auto const& channel = mChannels.find((directory.value() / feature).string());
+        if (channel == mChannels.end()) {
+            return nullptr;
+        }
+        return &channel->second;
+    }
+
+    // Safe to call from several threads as long as the channels aren't discovered again
+    std::optional<int32_t> read(HwmonChannel const& channel) const {
+        std::array<char, HWMON_READ_BUFFER_SIZE> buffer;
+        ssize_t const length(pread(channel.fd, buffer.data(), buffer.size(), 0));
+        if (length <= 0) {
+            return std::nullopt;
+        }
+        int64_t raw;
+        char const* end(buffer.data() + length);
+        if (std::from_chars(buffer.data(), end, raw).ec != std::errc()) {
+            return std::nullopt;
+        }
+        return static_cast<int32_t>(raw / channel.divisor);
+    }
+
+private:
+    static constexpr std::string_view INPUT_SUFFIX = "_input";
+
+    // Divisor for the raw value of an input attribute, hwmon reports voltages in mV, currents in
+    // mA, temperatures in m°C, fans in RPM, power in µW and humidity in m%RH
+    static std::optional<int64_t> inputDivisor(std::string_view fileName) {
+        static std::array<std::pair<std::string_view, int64_t>, 6> const _{
+            {{"in", 1}, {"curr", 1}, {"temp", 1000}, {"fan", 1}, {"power", 1000000},
+             {"humidity", 1000}}};
+        if (fileName.size() <= INPUT_SUFFIX.size() ||
+            fileName.substr(fileName.size() - INPUT_SUFFIX.size()) != INPUT_SUFFIX) {
+            return std::nullopt;
+        }
+        fileName.remove_suffix(INPUT_SUFFIX.size());
+        for (auto const& [type, divisor] : _) {
+            if (fileName.substr(0, type.size()) != type) {
+                continue;
+            }
+            std::string_view const index(fileName.substr(type.size()));
+            if (!index.empty() && index.find_first_not_of("0123456789") == std::string_view::npos) {
+                return divisor;
+            }
+        }
+        return std::nullopt;
+    }
+
+    static std::optional<Path> canonicalPath(Path const& path) {
+        std::error_code ec;
+        Path canonical(std::filesystem::canonical(path, ec));
+        if (ec) {
+            return std::nullopt;
+        }
+        return canonical;
+    }
+
+    static std::optional<std::string> readName(Path const& path) {
+        std::ifstream ifs(path);
+        std::string value;
+        if (ifs.fail() || !std::getline(ifs, value) || value.empty()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    std::unordered_map<std::string, HwmonChannel> mChannels;
+};
+
+}  // namespace hardware
+
+#endif  // HWMON_READER_H
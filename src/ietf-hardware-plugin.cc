@@ -32,12 +32,33 @@ int sr_plugin_init_cb(sr_session_ctx_t* session, void** /*private_data*/) {
     std::string const oper_xpath("/" + HardwareModel::moduleName + ":" + "hardware");
     try {
         hardware::HardwareSensors::getInstance().injectConnection(conn);
+        hardware::InventoryCache::getInstance().injectConnection(conn);
+        hardware::OperationalPusher::getInstance().injectConnection(conn);
         sysrepo::Subscription sub = ses.onModuleChange(
             HardwareModel::moduleName, &hardware::Callback::configurationCallback, std::nullopt, 0,
             sysrepo::SubscribeOptions::Enabled | sysrepo::SubscribeOptions::DoneOnly);
-        sub.onOperGet(HardwareModel::moduleName, &hardware::Callback::operationalCallback,
-                      oper_xpath);
+        // the first configuration callback applies the whole configuration, if subscribing didn't
+        // call it the settings and the sensors are set up here
+        hardware::Callback::applyInitialConfiguration(ses, HardwareModel::moduleName);
+        bool const push(hardware::PluginSettings::get()->operationalMode ==
+                        hardware::PluginSettings::OperationalMode::push);
+        if (!push) {
+            sub.onOperGet(HardwareModel::moduleName, &hardware::Callback::operationalCallback,
+                          oper_xpath);
+        }
+        try {
+            sub.onRPCAction("/hardware-plugin-augment:get-sensor-history",
+                            &hardware::Callback::sensorHistoryCallback);
+        } catch (std::exception const& e) {
+            logMessage(SR_LL_WRN, std::string("get-sensor-history not available: ") + e.what());
+        }
         theModel.sub = std::make_shared<sysrepo::Subscription>(std::move(sub));
+        hardware::InventoryCache::getInstance().start();
+        hardware::HardwareSensors::getInstance().startSampler();
+        if (push) {
+            hardware::OperationalPusher::getInstance().start(
+                &hardware::Callback::operationalTree, &hardware::Callback::sampledSensors);
+        }
     } catch (std::exception const& e) {
         logMessage(SR_LL_ERR, std::string("sr_plugin_init_cb: ") + e.what());
         theModel.sub.reset();
@@ -49,5 +70,9 @@ int sr_plugin_init_cb(sr_session_ctx_t* session, void** /*private_data*/) {
 
 void sr_plugin_cleanup_cb(sr_session_ctx_t* /*session*/, void* /*private_data*/) {
     theModel.sub.reset();
+    hardware::Callback::resetConfiguration();
+    hardware::OperationalPusher::getInstance().stop();
+    hardware::InventoryCache::getInstance().stop();
+    hardware::HardwareSensors::getInstance().stopSampler();
     logMessage(SR_LL_DBG, "plugin cleanup finished.");
 }
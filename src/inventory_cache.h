@@ -0,0 +1,266 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef INVENTORY_CACHE_H
+#define INVENTORY_CACHE_H
+
+#include <component_data.h>
+#include <lshw_collector.h>
+#include <operational_pusher.h>
+#include <plugin_settings.h>
+#include <sysfs_collector.h>
+#include <utils/fingerprint.h>
+#include <utils/globals.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sysrepo-cpp/Connection.hpp>
+#include <thread>
+
+namespace hardware {
+
+struct InventoryDiff {
+    bool empty() const {
+        return added.empty() && removed.empty() && modified.empty();
+    }
+
+    std::list<std::string> added;
+    std::list<std::string> removed;
+    std::list<std::string> modified;
+};
+
+struct InventorySnapshot {
+    // Components added, removed or modified compared to a previous snapshot
+    InventoryDiff diff(InventorySnapshot const& previous) const {
+        InventoryDiff result;
+        for (auto const& [name, fingerprint] : fingerprints) {
+            auto const& found = previous.fingerprints.find(name);
+            if (found == previous.fingerprints.end()) {
+                result.added.emplace_back(name);
+            } else if (found->second != fingerprint) {
+                result.modified.emplace_back(name);
+            }
+        }
+        for (auto const& [name, _] : previous.fingerprints) {
+            if (fingerprints.find(name) == fingerprints.end()) {
+                result.removed.emplace_back(name);
+            }
+        }
+        return result;
+    }
+
+    ComponentMap components;
+    std::unordered_map<std::string, uint64_t> fingerprints;
+    uint64_t digest;
+    std::time_t lastChange;
+};
+
+// Keeps the last collected hardware inventory so that operational requests don't have to probe
+// the hardware. A background thread rebuilds the inventory once its time-to-live has expired or
+// after it was explicitly invalidated (e.g. on a configuration change) and publishes it as an
+// immutable snapshot, readers never wait for a rebuild.
+struct InventoryCache {
+
+    static InventoryCache& getInstance() {
+        static InventoryCache instance;
+        return instance;
+    }
+
+    using Connection = sysrepo::Connection;
+
+    InventoryCache(InventoryCache const&) = delete;
+    void operator=(InventoryCache const&) = delete;
+
+    ~InventoryCache() {
+        stop();
+    }
+
+    void injectConnection(Connection conn) {
+        mConn = std::make_shared<Connection>(conn);
+    }
+
+    void start() {
+        std::lock_guard lk(mCacheMtx);
+        if (mRefresher.joinable()) {
+            return;
+        }
+        mStop = false;
+        mRefresher = std::thread(&InventoryCache::runFunc, this);
+    }
+
+    void stop() {
+        {
+            std::lock_guard lk(mCacheMtx);
+            mStop = true;
+        }
+        mCV.notify_all();
+        if (mRefresher.joinable()) {
+            mRefresher.join();
+        }
+    }
+
+    void setTimeToLive(std::chrono::seconds ttl) {
+        std::lock_guard lk(mCacheMtx);
+        mTimeToLive = ttl;
+    }
+
+    void setCollector(PluginSettings::Collector collector) {
+        std::lock_guard lk(mCacheMtx);
+        mCollector = collector;
+    }
+
+    void invalidate() {
+        {
+            std::lock_guard lk(mCacheMtx);
+            mInvalidated = true;
+        }
+        mCV.notify_all();
+    }
+
+    std::shared_ptr<InventorySnapshot const> getSnapshot() const {
+        return mSnapshot.load();
+    }
+
+    // Snapshot for an operational request. With a time-to-live of 0 the inventory is collected
+    // on demand by the requesting thread, otherwise the last collected one is served.
+    std::shared_ptr<InventorySnapshot const> requestSnapshot() {
+        PluginSettings::Collector collector;
+        {
+            std::lock_guard lk(mCacheMtx);
+            if (mTimeToLive.count() != 0) {
+                return mSnapshot.load();
+            }
+            collector = mCollector;
+        }
+        refresh(collector);
+        return mSnapshot.load();
+    }
+
+private:
+    InventoryCache()
+        : mTimeToLive(DEFAULT_INVENTORY_CACHE_TTL), mCollector(PluginSettings::Collector::lshw),
+          mInvalidated(false), mStop(false){};
+
+    // The configured collector is tried first, the other one serves as fallback
+    void refresh(PluginSettings::Collector collector) {
+        std::lock_guard lk(mRefreshMtx);
+        std::array<InventoryCollector*, 2> collectors{&mLshwCollector, &mSysfsCollector};
+        if (collector == PluginSettings::Collector::sysfs) {
+            std::swap(collectors[0], collectors[1]);
+        }
+
+        for (InventoryCollector* c : collectors) {
+            ComponentMap hwComponents;
+            if (c->collect(hwComponents)) {
+                logMessage(SR_LL_DBG, "Inventory rebuilt by " + c->name() + " with " +
+                                          std::to_string(hwComponents.size()) + " components.");
+                publish(std::move(hwComponents));
+                return;
+            }
+            logMessage(SR_LL_WRN, "Inventory collection through " + c->name() + " failed.");
+        }
+        logMessage(SR_LL_WRN, "Inventory rebuild failed, keeping the previous one.");
+    }
+
+    // last-change only advances when the content of the inventory differs from the previous one.
+    // An unchanged inventory keeps its snapshot, caches keyed on the snapshot stay valid.
+    void publish(ComponentMap&& hwComponents) {
+        auto snapshot(std::make_shared<InventorySnapshot>());
+        snapshot->components = std::move(hwComponents);
+        snapshot->digest = 0;
+        for (auto const& [name, component] : snapshot->components) {
+            uint64_t const fingerprint(component->fingerprint());
+            snapshot->fingerprints.emplace(name, fingerprint);
+            snapshot->digest += Fingerprint::mix(fingerprint);
+        }
+
+        auto const previous(mSnapshot.load());
+        if (previous && previous->digest == snapshot->digest) {
+            return;
+        }
+        snapshot->lastChange =
+            std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        mSnapshot.store(snapshot);
+        OperationalPusher::getInstance().notify();
+
+        if (previous) {
+            InventoryDiff const changes(snapshot->diff(*previous));
+            if (!changes.empty()) {
+                logMessage(SR_LL_INF, "Hardware inventory changed, added: " +
+                                          std::to_string(changes.added.size()) + ", removed: " +
+                                          std::to_string(changes.removed.size()) +
+                                          ", modified: " + std::to_string(changes.modified.size()));
+                sendStateChangeNotification();
+            }
+        }
+    }
+
+    void sendStateChangeNotification() {
+        if (!mConn) {
+            return;
+        }
+        try {
+            auto sess = mConn->sessionStart();
+            auto notification(sess.getContext().newPath("/ietf-hardware:hardware-state-change"));
+            sess.sendNotification(notification, sysrepo::Wait::No);
+        } catch (std::exception const& e) {
+            logMessage(SR_LL_WRN, "Sending hardware-state-change notification failed: " +
+                                      std::string(e.what()));
+        }
+    }
+
+    void runFunc() {
+        std::unique_lock<std::mutex> lk(mCacheMtx);
+        while (!mStop) {
+            mInvalidated = false;
+            PluginSettings::Collector const collector(mCollector);
+            lk.unlock();
+            refresh(collector);
+            lk.lock();
+            auto const wakeUp = [this] { return mStop || mInvalidated; };
+            bool const pushed(PluginSettings::get()->operationalMode ==
+                              PluginSettings::OperationalMode::push);
+            if (mTimeToLive.count() != 0) {
+                mCV.wait_for(lk, mTimeToLive, wakeUp);
+            } else if (pushed) {
+                // there are no requests to collect it on, the default time-to-live is used
+                mCV.wait_for(lk, std::chrono::seconds(DEFAULT_INVENTORY_CACHE_TTL), wakeUp);
+            } else {
+                // collected on demand, only invalidations are handled here
+                mCV.wait(lk, wakeUp);
+            }
+        }
+        logMessage(SR_LL_DBG, "Inventory refresher ended.");
+    }
+
+    std::shared_ptr<Connection> mConn;
+    std::atomic<std::shared_ptr<InventorySnapshot const>> mSnapshot;
+    std::mutex mCacheMtx;
+    // serializes collections by the refresher and on demand
+    std::mutex mRefreshMtx;
+    std::condition_variable mCV;
+    std::thread mRefresher;
+    std::chrono::seconds mTimeToLive;
+    PluginSettings::Collector mCollector;
+    LshwCollector mLshwCollector;
+    SysfsCollector mSysfsCollector;
+    bool mInvalidated;
+    bool mStop;
+};
+
+}  // namespace hardware
+
+#endif  // INVENTORY_CACHE_H
@@ -0,0 +1,42 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef INVENTORY_COLLECTOR_H
+#define INVENTORY_COLLECTOR_H
+
+#include <component_data.h>
+#include <utils/globals.h>
+
+#include <memory>
+#include <string>
+
+namespace hardware {
+
+// Source of the hardware inventory, fills the component map with every discovered component.
+struct InventoryCollector {
+
+    virtual ~InventoryCollector() = default;
+
+    virtual std::string name() const = 0;
+
+    virtual bool collect(ComponentMap& hwComponents) = 0;
+
+    // Filter a discovered component through configuration values
+    static void applyConfigData(std::shared_ptr<ComponentData> const& component) {
+        auto const configData(ComponentData::configData()->match(*component));
+        if (configData) {
+            component->replaceWritableValues(configData);
+        }
+    }
+};
+
+}  // namespace hardware
+
+#endif  // INVENTORY_COLLECTOR_H
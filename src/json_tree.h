@@ -0,0 +1,87 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef JSON_TREE_H
+#define JSON_TREE_H
+
+#include <component_data.h>
+#include <utils/globals.h>
+#include <utils/rapidjson/stringbuffer.h>
+#include <utils/rapidjson/writer.h>
+
+#include <optional>
+#include <string>
+
+namespace hardware {
+
+// Builds the operational hardware tree by serializing it into one JSON document that libyang
+// parses at once, instead of creating every node through its own newPath call. The buffer is
+// kept by each thread and only grows, so steady state requests don't allocate it again.
+struct JsonTree {
+
+    struct Statistics {
+        uint64_t dropped;
+        uint64_t coalesced;
+    };
+
+    static std::optional<libyang::DataNode> build(libyang::Context const& context,
+                                                  std::optional<std::string> const& lastChange,
+                                                  ComponentMap const& hwComponents,
+                                                  bool setPhysicalID,
+                                                  std::optional<Statistics> const& statistics) {
+        thread_local rapidjson::StringBuffer buffer;
+        buffer.Clear();
+        JsonWriter writer(buffer);
+
+        writer.StartObject();
+        writer.Key("ietf-hardware:hardware");
+        writer.StartObject();
+        // +--ro last-change?   yang:date-and-time
+        if (lastChange) {
+            ComponentData::writeJsonMember(writer, "last-change", lastChange.value());
+        }
+        // +--rw component* [name]
+        if (!hwComponents.empty()) {
+            writer.Key("component");
+            writer.StartArray();
+            for (auto const& c : hwComponents) {
+                c.second->writeJson(writer, setPhysicalID);
+            }
+            writer.EndArray();
+        }
+        // +--ro notification-statistics, 64 bit integers are encoded as strings
+        if (statistics) {
+            writer.Key("hardware-plugin-augment:plugin-settings");
+            writer.StartObject();
+            writer.Key("notification-statistics");
+            writer.StartObject();
+            ComponentData::writeJsonMember(writer, "dropped",
+                                           std::to_string(statistics->dropped));
+            ComponentData::writeJsonMember(writer, "coalesced",
+                                           std::to_string(statistics->coalesced));
+            writer.EndObject();
+            writer.EndObject();
+        }
+        writer.EndObject();
+        writer.EndObject();
+
+        try {
+            return context.parseData(std::string(buffer.GetString(), buffer.GetSize()),
+                                     libyang::DataFormat::JSON, libyang::ParseOptions::ParseOnly);
+        } catch (std::exception const& e) {
+            logMessage(SR_LL_WRN, "Parsing the hardware tree failed: " + std::string(e.what()));
+        }
+        return std::nullopt;
+    }
+};
+
+}  // namespace hardware
+
+#endif  // JSON_TREE_H
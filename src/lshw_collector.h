@@ -0,0 +1,299 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef LSHW_COLLECTOR_H
+#define LSHW_COLLECTOR_H
+
+#include <component_data.h>
+#include <inventory_collector.h>
+#include <utils/globals.h>
+#include <utils/rapidjson/filereadstream.h>
+#include <utils/rapidjson/reader.h>
+
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace hardware {
+
+// SAX handler building ComponentData directly from the lshw json output. A component is
+// finalized (named, matched against the configuration and inserted) as soon as its "children"
+// array starts or, for components without children, when its object closes.
+struct LshwHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, LshwHandler> {
+
+    using SizeType = rapidjson::SizeType;
+
+    enum class FrameType { Component, Configuration, Children, Ignored };
+
+    struct Frame {
+        Frame(FrameType frameType)
+            : type(frameType), finalized(false), skipped(false), childPos(0){};
+
+        FrameType type;
+        std::shared_ptr<ComponentData> component;
+        std::optional<std::string> id;
+        bool finalized;
+        bool skipped;
+        int32_t childPos;
+        std::list<std::string> children;
+    };
+
+    LshwHandler(ComponentMap& components) : hwComponents(components){};
+
+    bool StartObject() {
+        if (mFrames.empty() || mFrames.back().type == FrameType::Children) {
+            mFrames.emplace_back(FrameType::Component);
+            mFrames.back().component = std::make_shared<ComponentData>(std::string());
+        } else if (mFrames.back().type == FrameType::Component && mKey == "configuration") {
+            mFrames.emplace_back(FrameType::Configuration);
+        } else {
+            mFrames.emplace_back(FrameType::Ignored);
+        }
+        return true;
+    }
+
+    bool EndObject(SizeType /* memberCount */) {
+        if (mFrames.back().type == FrameType::Component) {
+            finalizeComponent();
+            Frame& frame = mFrames.back();
+            Frame* parent = parentComponent();
+            if (!frame.skipped) {
+                frame.component->children = std::move(frame.children);
+                if (parent) {
+                    parent->children.emplace_back(frame.component->name);
+                }
+            }
+        }
+        mFrames.pop_back();
+        return true;
+    }
+
+    bool StartArray() {
+        if (mFrames.empty()) {
+            mFrames.emplace_back(FrameType::Children);
+        } else if (mFrames.back().type == FrameType::Component && mKey == "children") {
+            // +--ro contains-child*   -> ../../component/name
+            finalizeComponent();
+            bool const skipped(mFrames.back().skipped);
+            mFrames.emplace_back(skipped ? FrameType::Ignored : FrameType::Children);
+        } else {
+            mFrames.emplace_back(FrameType::Ignored);
+        }
+        return true;
+    }
+
+    bool EndArray(SizeType /* elementCount */) {
+        mFrames.pop_back();
+        return true;
+    }
+
+    bool Key(char const* str, SizeType length, bool /* copy */) {
+        mKey.assign(str, length);
+        return true;
+    }
+
+    bool String(char const* str, SizeType length, bool /* copy */) {
+        if (mFrames.empty()) {
+            return true;
+        }
+        Frame& frame = mFrames.back();
+        if (frame.type == FrameType::Component) {
+            std::string value(str, length);
+            if (mKey == "id") {
+                frame.id = std::move(value);
+            } else if (mKey == "class") {
+                // +--rw class             identityref
+                frame.component->classType = toIANAclass(value);
+            } else if (mKey == "physid") {
+                // +--ro physical-index?   int32 {entity-mib}?
+                frame.component->parseAndSetPhysicalID(value);
+            } else {
+                // +--ro description?      string
+                // +--ro hardware-rev?     string
+                // +--ro serial-num?       string
+                // +--ro mfg-name?         string
+                // +--ro model-name?       string
+                // +--rw alias?            string
+                frame.component->setValueFromLSHWmap(mKey, value);
+            }
+        } else if (frame.type == FrameType::Configuration) {
+            // +--ro software-rev?     string
+            // +--ro firmware-rev?     string
+            // +--ro uuid?             yang:uuid
+            auto const& component = mFrames[mFrames.size() - 2].component;
+            if (mKey == "uuid") {
+                component->uuid = std::string(str, length);
+            } else if (mKey == "driverversion") {
+                component->softwareRev = std::string(str, length);
+            } else if (mKey == "firmware") {
+                component->firmwareRev = std::string(str, length);
+            }
+        }
+        return true;
+    }
+
+    static std::string toIANAclass(std::string const& inputClass) {
+        std::string returnedClass("iana-hardware:unknown");
+        static std::unordered_map<std::string, std::string> _{
+            {"storage", "iana-hardware:storage-drive"},
+            {"power", "iana-hardware:battery"},
+            {"processor", "iana-hardware:cpu"},
+            {"network", "iana-hardware:port"}};
+
+        if (_.find(inputClass) != _.end()) {
+            returnedClass = _.at(inputClass);
+        }
+        return returnedClass;
+    }
+
+private:
+    // Component whose children array contains the current component
+    Frame* parentComponent() {
+        if (mFrames.size() < 3) {
+            return nullptr;
+        }
+        Frame& parent = mFrames[mFrames.size() - 3];
+        return parent.type == FrameType::Component ? &parent : nullptr;
+    }
+
+    void finalizeComponent() {
+        Frame& frame = mFrames.back();
+        if (frame.finalized) {
+            return;
+        }
+        frame.finalized = true;
+
+        // invalid entry, go to the next one
+        if (!frame.id) {
+            frame.skipped = true;
+            return;
+        }
+
+        auto& component = frame.component;
+        Frame* parent = parentComponent();
+        std::string const parentName(parent ? parent->component->name : std::string());
+        component->name = frame.id.value();
+
+        // firmware node, skip this one and set the parent's firmware-rev
+        // +--ro firmware-rev?     string
+        if (component->name == "firmware" && parent && component->hardwareRev) {
+            parent->component->firmwareRev = component->hardwareRev;
+            frame.skipped = true;
+            return;
+        }
+
+        // Check if a node with the current name exists, if so rename the current one
+        if (hwComponents.find(component->name) != hwComponents.end()) {
+            component->name = parentName + ":" + component->name;
+        }
+
+        // +--rw parent?           -> ../../component/name
+        // +--rw parent-rel-pos?   int32
+        if (parent) {
+            component->parentName = parentName;
+            component->parent_rel_pos = parent->childPos;
+            parent->childPos++;
+        }
+
+        // Filter parsed component through configuration values
+        InventoryCollector::applyConfigData(component);
+
+        hwComponents.insert(std::make_pair(component->name, component));
+    }
+
+    ComponentMap& hwComponents;
+    std::deque<Frame> mFrames;
+    std::string mKey;
+};
+
+struct LshwCollector : public InventoryCollector {
+    using Reader = rapidjson::Reader;
+    using FileReadStream = rapidjson::FileReadStream;
+
+    std::string name() const override {
+        return "lshw";
+    }
+
+    bool collect(ComponentMap& hwComponents) override {
+        pid_t pid;
+        FILE* stream = spawnLshw(pid);
+        if (!stream) {
+            return false;
+        }
+
+        // lshw output is parsed while it is being produced
+        char buffer[LSHW_READ_BUFFER_SIZE];
+        FileReadStream frs(stream, buffer, sizeof(buffer));
+        LshwHandler handler(hwComponents);
+        Reader reader;
+        rapidjson::ParseResult const result(reader.Parse(frs, handler));
+        // closing the read end first makes sure lshw can't block on a full pipe
+        fclose(stream);
+
+        int status(0);
+        if (waitpid(pid, &status, 0) == -1) {
+            logMessage(SR_LL_WRN, "waitpid for lshw failed: " + std::string(strerror(errno)));
+        } else {
+            logMessage(SR_LL_DBG, "lshw command returned:" + std::to_string(status));
+        }
+
+        if (result.IsError()) {
+            logMessage(SR_LL_ERR, "lshw json output couldn't be parsed at offset: " +
+                                      std::to_string(result.Offset()));
+            return false;
+        }
+        if (hwComponents.empty()) {
+            logMessage(SR_LL_ERR, "lshw json output contains no components");
+            return false;
+        }
+        return true;
+    }
+
+    // Runs lshw without a shell and returns a stream connected to its standard output
+    static FILE* spawnLshw(pid_t& pid) {
+        int pipeFds[2];
+        if (pipe2(pipeFds, O_CLOEXEC) == -1) {
+            logMessage(SR_LL_ERR, "Can't create pipe for lshw: " + std::string(strerror(errno)));
+            return nullptr;
+        }
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, pipeFds[1], STDOUT_FILENO);
+        posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+        char* const argv[] = {const_cast<char*>(LSHW_LOCATION), const_cast<char*>("-json"),
+                              nullptr};
+        int rc = posix_spawn(&pid, LSHW_LOCATION, &actions, nullptr, argv, environ);
+        posix_spawn_file_actions_destroy(&actions);
+        close(pipeFds[1]);
+        if (rc != 0) {
+            logMessage(SR_LL_ERR, "lshw command failed: " + std::string(strerror(rc)));
+            close(pipeFds[0]);
+            return nullptr;
+        }
+
+        FILE* stream = fdopen(pipeFds[0], "r");
+        if (!stream) {
+            logMessage(SR_LL_ERR, "Can't read lshw output: " + std::string(strerror(errno)));
+            close(pipeFds[0]);
+            waitpid(pid, nullptr, 0);
+        }
+        return stream;
+    }
+};
+
+}  // namespace hardware
+
+#endif  // LSHW_COLLECTOR_H
@@ -0,0 +1,205 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef NOTIFICATION_QUEUE_H
+#define NOTIFICATION_QUEUE_H
+
+#include <component_data.h>
+#include <notification_sender.h>
+#include <plugin_settings.h>
+#include <utils/bounded_ring.h>
+#include <utils/globals.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace hardware {
+
+// Latest crossing of a threshold whose notification is still waiting in the queue, newer
+// crossings of the same threshold replace it when the queue coalesces. The crossing and whether
+// a notification is queued for it share one atomic word, so the worker takes the crossing and
+// makes room for the next notification in a single step.
+struct PendingNotification {
+
+    static constexpr uint64_t QUEUED = 1ULL << 63;
+
+    PendingNotification() : state(0){};
+
+    // Stores the crossing, returns whether a queued notification will carry it
+    bool replace(int32_t sensorValue, bool rising) {
+        return state.exchange(pack(sensorValue, rising) | QUEUED) & QUEUED;
+    }
+
+    // The notification carrying the crossing isn't queued anymore
+    void unqueue() {
+        state.fetch_and(~QUEUED);
+    }
+
+    // Latest crossing, a newer one is queued in a notification of its own from now on
+    void take(int32_t& sensorValue, bool& rising) {
+        uint64_t const packed(state.fetch_and(~QUEUED));
+        sensorValue = int32_t(uint32_t(packed >> 1));
+        rising = packed & 1;
+    }
+
+private:
+    static uint64_t pack(int32_t sensorValue, bool rising) {
+        return (uint64_t(uint32_t(sensorValue)) << 1) | (rising ? 1 : 0);
+    }
+
+    std::atomic<uint64_t> state;
+};
+
+struct NotificationEvent {
+    std::string componentName;
+    std::shared_ptr<SensorThreshold const> threshold;
+    int32_t sensorValue;
+    bool rising;
+    std::shared_ptr<PendingNotification> pending;
+};
+
+// Decouples sampling from notification delivery. Samplers push threshold crossings into a
+// bounded lock-free ring and return immediately, a dedicated worker delivers them through its
+// own NotificationSender. When the ring is full the oldest notification is dropped, or with
+// coalescing every threshold has at most one notification waiting, carrying its latest crossing.
+struct NotificationQueue {
+
+    using Connection = sysrepo::Connection;
+
+    NotificationQueue()
+        : mRing(NOTIFICATION_QUEUE_SIZE),
+          mOverflow(PluginSettings::NotificationOverflow::dropOldest), mSignal(0),
+          mTemplatesInvalid(false), mStop(false), mDropped(0), mCoalesced(0){};
+
+    NotificationQueue(NotificationQueue const&) = delete;
+    void operator=(NotificationQueue const&) = delete;
+
+    ~NotificationQueue() {
+        stop();
+    }
+
+    // Must be called before the worker is started
+    void injectConnection(std::shared_ptr<Connection> conn) {
+        mSender.injectConnection(conn);
+    }
+
+    void start() {
+        if (mWorker.joinable()) {
+            return;
+        }
+        mStop = false;
+        mWorker = std::thread(&NotificationQueue::runFunc, this);
+    }
+
+    void stop() {
+        mStop = true;
+        mSignal.fetch_add(1);
+        mSignal.notify_all();
+        if (mWorker.joinable()) {
+            mWorker.join();
+        }
+    }
+
+    void setOverflowPolicy(PluginSettings::NotificationOverflow overflow) {
+        mOverflow = overflow;
+    }
+
+    // Thresholds have been reconfigured, prebuilt notifications must be built again
+    void invalidateTemplates() {
+        mTemplatesInvalid = true;
+    }
+
+    void enqueue(NotificationEvent&& event) {
+        if (mOverflow == PluginSettings::NotificationOverflow::coalesce && event.pending) {
+            std::shared_ptr<PendingNotification> const pending(event.pending);
+            if (pending->replace(event.sensorValue, event.rising)) {
+                mCoalesced.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (!mRing.tryPush(std::move(event))) {
+                pending->unqueue();
+                mDropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        } else {
+            event.pending.reset();
+            while (!mRing.tryPush(std::move(event))) {
+                std::optional<NotificationEvent> oldest(mRing.tryPop());
+                if (oldest) {
+                    if (oldest->pending) {
+                        oldest->pending->unqueue();
+                    }
+                    mDropped.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+        mSignal.fetch_add(1, std::memory_order_release);
+        mSignal.notify_one();
+    }
+
+    uint64_t dropped() const {
+        return mDropped.load(std::memory_order_relaxed);
+    }
+
+    uint64_t coalesced() const {
+        return mCoalesced.load(std::memory_order_relaxed);
+    }
+
+private:
+    void deliver(NotificationEvent const& event) {
+        int32_t sensorValue(event.sensorValue);
+        bool rising(event.rising);
+        if (event.pending) {
+            event.pending->take(sensorValue, rising);
+        }
+
+        logMessage(SR_LL_INF, "Sensor threshold " + event.threshold->name +
+                                  (rising ? " crossed rising" : " crossed falling") +
+                                  " for: " + event.componentName + " value " +
+                                  std::to_string(sensorValue) + ". Sending Notification...");
+        try {
+            mSender.send(event.componentName, *event.threshold, sensorValue, rising);
+        } catch (std::exception& ex) {
+            logMessage(SR_LL_WRN, "Sending notification failed: " + std::string(ex.what()));
+        }
+    }
+
+    void runFunc() {
+        while (!mStop) {
+            uint32_t const signal(mSignal.load(std::memory_order_acquire));
+            std::optional<NotificationEvent> event(mRing.tryPop());
+            if (!event) {
+                mSignal.wait(signal, std::memory_order_acquire);
+                continue;
+            }
+            if (mTemplatesInvalid.exchange(false)) {
+                mSender.clear();
+            }
+            deliver(event.value());
+        }
+        logMessage(SR_LL_DBG, "Notification delivery ended.");
+    }
+
+    BoundedRing<NotificationEvent> mRing;
+    NotificationSender mSender;
+    std::thread mWorker;
+    std::atomic<PluginSettings::NotificationOverflow> mOverflow;
+    std::atomic<uint32_t> mSignal;
+    std::atomic<bool> mTemplatesInvalid;
+    std::atomic<bool> mStop;
+    std::atomic<uint64_t> mDropped;
+    std::atomic<uint64_t> mCoalesced;
+};
+
+}  // namespace hardware
+
+#endif  // NOTIFICATION_QUEUE_H
@@ -0,0 +1,117 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef NOTIFICATION_SENDER_H
+#define NOTIFICATION_SENDER_H
+
+#include <component_data.h>
+#include <utils/globals.h>
+
+#include <libyang-cpp/DataNode.hpp>
+#include <libyang/libyang.h>
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <sysrepo-cpp/Connection.hpp>
+#include <tuple>
+
+namespace hardware {
+
+// Sends sensor-threshold-crossed notifications through a session that is kept for the lifetime
+// of the sender. The notification tree of every threshold and direction is built once, sending
+// only changes its sensor-value leaf in place. A sender must only be used by a single thread.
+struct NotificationSender {
+
+    using Connection = sysrepo::Connection;
+    using Session = sysrepo::Session;
+
+    void injectConnection(std::shared_ptr<Connection> conn) {
+        mConn = conn;
+        reset();
+    }
+
+    void send(std::string const& componentName,
+              SensorThreshold const& threshold,
+              int32_t sensorValue,
+              bool rising) {
+        if (!mConn) {
+            return;
+        }
+        try {
+            NotificationTemplate& notification(getTemplate(componentName, threshold, rising));
+            std::string const value(std::to_string(sensorValue));
+            LY_ERR const rc(
+                lyd_change_term(libyang::getRawNode(notification.sensorValue), value.c_str()));
+            if (rc != LY_SUCCESS && rc != LY_EEXIST && rc != LY_ENOT) {
+                throw std::runtime_error("Couldn't set sensor-value " + value);
+            }
+            mSession->sendNotification(notification.tree, sysrepo::Wait::No);
+        } catch (std::exception const&) {
+            // the session may be unusable, start over with a new one on the next notification
+            reset();
+            throw;
+        }
+    }
+
+    // Drops the templates, e.g. after the thresholds have been reconfigured
+    void clear() {
+        mTemplates.clear();
+    }
+
+private:
+    struct NotificationTemplate {
+        libyang::DataNode tree;
+        libyang::DataNode sensorValue;
+    };
+
+    using TemplateKey = std::tuple<std::string, std::string, bool>;
+
+    void reset() {
+        mTemplates.clear();
+        mSession.reset();
+    }
+
+    NotificationTemplate& getTemplate(std::string const& componentName,
+                                      SensorThreshold const& threshold,
+                                      bool rising) {
+        TemplateKey key(componentName, threshold.name, rising);
+        auto const& found = mTemplates.find(key);
+        if (found != mTemplates.end()) {
+            return found->second;
+        }
+
+        if (!mSession) {
+            mSession = mConn->sessionStart();
+        }
+        std::string notifPath("/ietf-hardware:hardware/component[name='");
+        notifPath += componentName + "']/sensor-notifications-augment:sensor-threshold-crossed";
+
+        auto tree = mSession->getContext().newPath((notifPath + "/threshold-name"), threshold.name);
+        tree.newPath((notifPath + "/threshold-value"), std::to_string(threshold.value));
+        tree.newPath((notifPath + (rising ? "/rising" : "/falling")), std::nullopt);
+        auto sensorValue = tree.newPath2((notifPath + "/sensor-value"), "0").createdNode;
+        if (!sensorValue) {
+            throw std::runtime_error("Couldn't create sensor-value of " + notifPath);
+        }
+        return mTemplates.emplace(std::move(key), NotificationTemplate{tree, sensorValue.value()})
+            .first->second;
+    }
+
+    std::shared_ptr<Connection> mConn;
+    std::optional<Session> mSession;
+    std::map<TemplateKey, NotificationTemplate> mTemplates;
+};
+
+}  // namespace hardware
+
+#endif  // NOTIFICATION_SENDER_H
@@ -0,0 +1,316 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef OPERATIONAL_PUSHER_H
+#define OPERATIONAL_PUSHER_H
+
+#include <component_data.h>
+#include <json_tree.h>
+#include <tree_patch.h>
+#include <utils/globals.h>
+
+#include <libyang-cpp/DataNode.hpp>
+#include <libyang/libyang.h>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <sysrepo-cpp/Connection.hpp>
+#include <thread>
+#include <vector>
+
+namespace hardware {
+
+// Writes the operational hardware tree into the operational datastore so that readers are served
+// by sysrepo without calling into the plugin. The whole tree is loaded in one edit batch when
+// pushing starts. When the inventory or the configuration changed the tree is built again and
+// only its difference to the pushed tree is edited. A batch of sensor samples only changes the
+// leaves of the sampled sensors in the pushed tree and sets the ones that differ. Notifications
+// arriving while a push is running are coalesced into the next one.
+struct OperationalPusher {
+
+    using Connection = sysrepo::Connection;
+    using Session = sysrepo::Session;
+    using TreeBuilder = std::function<std::optional<libyang::DataNode>(Session&)>;
+
+    // Latest samples of the sampled sensors and the statistics, if the pushed tree has them
+    struct SensorUpdate {
+        ComponentMap sensors;
+        std::optional<JsonTree::Statistics> statistics;
+    };
+    using SensorSource = std::function<SensorUpdate(Session&, std::set<std::string> const&)>;
+
+    static OperationalPusher& getInstance() {
+        static OperationalPusher instance;
+        return instance;
+    }
+
+    OperationalPusher(OperationalPusher const&) = delete;
+    void operator=(OperationalPusher const&) = delete;
+
+    ~OperationalPusher() {
+        stop();
+    }
+
+    void injectConnection(Connection conn) {
+        mConn = std::make_shared<Connection>(conn);
+    }
+
+    void start(TreeBuilder builder, SensorSource sensors) {
+        std::lock_guard lk(mPushMtx);
+        if (mPusher.joinable() || !mConn) {
+            return;
+        }
+        try {
+            mSession.emplace(mConn->sessionStart());
+            mSession->switchDatastore(sysrepo::Datastore::Operational);
+            // data left behind by a previous run of the plugin
+            mSession->discardOperationalChanges(operationalXpath());
+        } catch (std::exception const& e) {
+            logMessage(SR_LL_ERR, "Operational session failure: " + std::string(e.what()));
+            mSession.reset();
+            return;
+        }
+        mBuilder = std::move(builder);
+        mSensors = std::move(sensors);
+        mStop = false;
+        mTreePending = true;
+        mPusher = std::thread(&OperationalPusher::runFunc, this);
+    }
+
+    void stop() {
+        {
+            std::lock_guard lk(mPushMtx);
+            mStop = true;
+            mSampled.clear();
+        }
+        mPushCV.notify_all();
+        if (mPusher.joinable()) {
+            mPusher.join();
+        }
+        // pushed data is owned by the session and removed with it
+        mPushed.reset();
+        mSession.reset();
+    }
+
+    bool running() {
+        std::lock_guard lk(mPushMtx);
+        return mPusher.joinable();
+    }
+
+    // Schedules a push of the whole tree, a no-op while operational data is pulled
+    void notify() {
+        {
+            std::lock_guard lk(mPushMtx);
+            if (!mPusher.joinable()) {
+                return;
+            }
+            mTreePending = true;
+        }
+        mPushCV.notify_all();
+    }
+
+    // Schedules a push of the sensor leaves of newly sampled sensors
+    void notifySamples(std::vector<std::string> const& sensorNames) {
+        {
+            std::lock_guard lk(mPushMtx);
+            if (!mPusher.joinable() || sensorNames.empty()) {
+                return;
+            }
+            mSampled.insert(sensorNames.begin(), sensorNames.end());
+        }
+        mPushCV.notify_all();
+    }
+
+private:
+    OperationalPusher() : mTreePending(false), mStop(false){};
+
+    static std::string operationalXpath() {
+        return TreePatch::hardwarePath();
+    }
+
+    // Turns a node of a libyang diff into edits. Nodes without an operation of their own inherit
+    // the one of their parent, created subtrees are set leaf by leaf.
+    size_t editDiff(libyang::DataNode const& node, std::string const& inherited) {
+        std::string operation(inherited);
+        for (auto const& meta : node.meta()) {
+            if (meta.module().name() == "yang" && meta.name() == "operation") {
+                operation = meta.valueStr();
+            }
+        }
+        std::string const path(node.path());
+        if (operation == "delete") {
+            mSession->deleteItem(path);
+            return 1;
+        }
+
+        libyang::NodeType const type(node.schema().nodeType());
+        if (type == libyang::NodeType::Leaf || type == libyang::NodeType::Leaflist) {
+            if (operation == "none" ||
+                (type == libyang::NodeType::Leaf && node.schema().asLeaf().isKey())) {
+                return 0;
+            }
+            mSession->setItem(path, std::string(node.asTerm().valueStr()));
+            return 1;
+        }
+        size_t edits(0);
+        if (operation == "create") {
+            mSession->setItem(path, std::nullopt);
+            edits++;
+        }
+        for (auto const& child : node.immediateChildren()) {
+            edits += editDiff(child, operation == "create" ? operation : "none");
+        }
+        return edits;
+    }
+
+    // Edits turning the pushed tree into the given one
+    size_t editDifference(libyang::DataNode const& tree) {
+        lyd_node* diff(nullptr);
+        if (lyd_diff_siblings(libyang::getRawNode(mPushed.value()), libyang::getRawNode(tree), 0,
+                              &diff) != LY_SUCCESS) {
+            throw std::runtime_error("diff of the operational tree failed");
+        }
+        if (!diff) {
+            return 0;
+        }
+        size_t edits(0);
+        libyang::DataNode const changes(libyang::wrapRawNode(diff));
+        for (auto const& node : changes.siblings()) {
+            edits += editDiff(node, "none");
+        }
+        return edits;
+    }
+
+    void pushTree() {
+        std::optional<libyang::DataNode> tree;
+        try {
+            tree = mBuilder(mSession.value());
+        } catch (std::exception const& e) {
+            logMessage(SR_LL_WRN, "Building the operational tree failed: " + std::string(e.what()));
+        }
+        if (!tree) {
+            return;
+        }
+
+        try {
+            if (!mPushed) {
+                mSession->editBatch(tree.value(), sysrepo::DefaultOperation::Merge);
+                mSession->applyChanges();
+                logMessage(SR_LL_DBG, "Pushed the operational hardware tree.");
+            } else if (size_t const edits = editDifference(tree.value())) {
+                mSession->applyChanges();
+                logMessage(SR_LL_DBG, "Pushed " + std::to_string(edits) +
+                                          " operational edits of the hardware tree.");
+            }
+            mPushed = tree;
+        } catch (std::exception const& e) {
+            reset("Pushing operational data failed: " + std::string(e.what()));
+        }
+    }
+
+    void pushSensors(std::set<std::string> const& sensorNames) {
+        if (!mPushed) {
+            pushTree();
+            return;
+        }
+        try {
+            SensorUpdate const update(mSensors(mSession.value(), sensorNames));
+            TreePatch::Changed changed;
+            bool patched(true);
+            for (auto const& [name, component] : update.sensors) {
+                auto const* sensor(dynamic_cast<Sensor const*>(component.get()));
+                if (sensor && patched) {
+                    patched &= TreePatch::sensor(mPushed.value(), *sensor, &changed);
+                }
+            }
+            if (update.statistics && patched) {
+                patched &= TreePatch::statistics(mPushed.value(), update.statistics.value(),
+                                                 &changed);
+            }
+            if (!patched) {
+                // a sensor or a history window the pushed tree doesn't have yet
+                logMessage(SR_LL_DBG, "Pushed hardware tree doesn't match, pushing it again.");
+                pushTree();
+                return;
+            }
+            for (auto const& leaf : changed) {
+                mSession->setItem(leaf.path(), std::string(leaf.asTerm().valueStr()));
+            }
+            if (!changed.empty()) {
+                mSession->applyChanges();
+                logMessage(SR_LL_DBG, "Pushed " + std::to_string(changed.size()) +
+                                          " operational sensor leaves.");
+            }
+        } catch (std::exception const& e) {
+            // the pushed tree is already changed, the datastore may not be
+            reset("Pushing operational sensor data failed: " + std::string(e.what()));
+        }
+    }
+
+    // Starts over with the whole tree on the next push
+    void reset(std::string const& reason) {
+        logMessage(SR_LL_WRN, reason);
+        try {
+            mSession->discardChanges();
+            mSession->discardOperationalChanges(operationalXpath());
+        } catch (std::exception const& discardError) {
+            logMessage(SR_LL_WRN,
+                       "Discarding operational data failed: " + std::string(discardError.what()));
+        }
+        mPushed.reset();
+    }
+
+    void runFunc() {
+        std::unique_lock<std::mutex> lk(mPushMtx);
+        while (!mStop) {
+            mPushCV.wait(lk, [this] { return mStop || mTreePending || !mSampled.empty(); });
+            if (mStop) {
+                break;
+            }
+            // a tree push takes the latest samples as well
+            bool const tree(mTreePending);
+            mTreePending = false;
+            std::set<std::string> sampled;
+            sampled.swap(mSampled);
+            lk.unlock();
+            if (tree) {
+                pushTree();
+            } else {
+                pushSensors(sampled);
+            }
+            lk.lock();
+        }
+        logMessage(SR_LL_DBG, "Operational pusher ended.");
+    }
+
+    std::shared_ptr<Connection> mConn;
+    // owned by the pusher thread while it runs
+    std::optional<Session> mSession;
+    TreeBuilder mBuilder;
+    SensorSource mSensors;
+    // the tree as it is in the operational datastore
+    std::optional<libyang::DataNode> mPushed;
+    std::mutex mPushMtx;
+    std::condition_variable mPushCV;
+    std::thread mPusher;
+    std::set<std::string> mSampled;
+    bool mTreePending;
+    bool mStop;
+};
+
+}  // namespace hardware
+
+#endif  // OPERATIONAL_PUSHER_H
@@ -0,0 +1,178 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef PLUGIN_SETTINGS_H
+#define PLUGIN_SETTINGS_H
+
+#include <utils/globals.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace hardware {
+
+struct PluginSettings {
+
+    using Session = sysrepo::Session;
+
+    enum class Collector { lshw, sysfs };
+
+    enum class SensorReader { hwmon, libsensors };
+
+    enum class NotificationOverflow { dropOldest, coalesce };
+
+    enum class TreeBuild { nodes, json };
+
+    enum class OperationalMode { pull, push };
+
+    PluginSettings()
+        : inventoryCacheTTL(DEFAULT_INVENTORY_CACHE_TTL), inventoryCollector(Collector::lshw),
+          sensorSampleInterval(DEFAULT_SENSOR_SAMPLE_INTERVAL), sensorReader(SensorReader::hwmon),
+          notificationOverflow(NotificationOverflow::dropOldest),
+          historyWindows(defaultHistoryWindows()), timeseriesStore(false),
+          timeseriesRetention(DEFAULT_TIMESERIES_RETENTION), operationalTreeBuild(TreeBuild::json),
+          operationalMode(OperationalMode::pull){};
+
+    static std::string settingsXpath(std::string_view module_name) {
+        return std::string("/") + std::string(module_name) +
+               ":hardware/hardware-plugin-augment:plugin-settings";
+    }
+
+    // Reads the settings and publishes them as a new snapshot, settings that aren't configured
+    // keep their defaults
+    static void populateSettings(Session& session, std::string_view module_name) {
+        auto settings(std::make_shared<PluginSettings>());
+        settings->read(session, module_name);
+        current.store(std::move(settings));
+    }
+
+    // Settings in effect. A snapshot is never modified once it has been published, readers on
+    // other threads keep using theirs while a new one is swapped in.
+    static std::shared_ptr<PluginSettings const> get() {
+        auto settings(current.load());
+        if (!settings) {
+            settings = std::make_shared<PluginSettings const>();
+        }
+        return settings;
+    }
+
+    static std::vector<std::chrono::seconds> defaultHistoryWindows() {
+        return {std::chrono::minutes(1), std::chrono::minutes(5), std::chrono::hours(1)};
+    }
+
+    std::chrono::seconds inventoryCacheTTL;
+    Collector inventoryCollector;
+    std::chrono::seconds sensorSampleInterval;
+    SensorReader sensorReader;
+    NotificationOverflow notificationOverflow;
+    std::vector<std::chrono::seconds> historyWindows;
+    bool timeseriesStore;
+    std::chrono::hours timeseriesRetention;
+    TreeBuild operationalTreeBuild;
+    OperationalMode operationalMode;
+
+private:
+    void read(Session& session, std::string_view module_name) {
+        std::string const settings_xpath(settingsXpath(module_name));
+        std::optional<libyang::DataNode> data;
+        try {
+            data = session.getData(settings_xpath);
+        } catch (std::exception const& e) {
+            logMessage(SR_LL_DBG, "No plugin settings available: " + std::string(e.what()));
+            return;
+        }
+        if (!data) {
+            return;
+        }
+
+        // +--rw inventory-cache-ttl?   uint32
+        auto const ttl(data.value().findPath(settings_xpath + "/inventory-cache-ttl"));
+        if (ttl) {
+            inventoryCacheTTL = std::chrono::seconds(std::get<uint32_t>(ttl->asTerm().value()));
+        }
+
+        // +--rw inventory-collector?   enumeration
+        auto const collector(data.value().findPath(settings_xpath + "/inventory-collector"));
+        if (collector && collector->asTerm().valueStr() == "sysfs") {
+            inventoryCollector = Collector::sysfs;
+        }
+
+        // +--rw sensor-sample-interval?   uint32
+        auto const sampleInterval(
+            data.value().findPath(settings_xpath + "/sensor-sample-interval"));
+        if (sampleInterval) {
+            sensorSampleInterval =
+                std::chrono::seconds(std::get<uint32_t>(sampleInterval->asTerm().value()));
+        }
+
+        // +--rw sensor-reader?   enumeration
+        auto const reader(data.value().findPath(settings_xpath + "/sensor-reader"));
+        if (reader && reader->asTerm().valueStr() == "libsensors") {
+            sensorReader = SensorReader::libsensors;
+        }
+
+        // +--rw notification-overflow?   enumeration
+        auto const overflow(data.value().findPath(settings_xpath + "/notification-overflow"));
+        if (overflow && overflow->asTerm().valueStr() == "coalesce") {
+            notificationOverflow = NotificationOverflow::coalesce;
+        }
+
+        // +--rw history-window*   uint32
+        auto const settings(data.value().findPath(settings_xpath));
+        if (settings) {
+            std::vector<std::chrono::seconds> windows;
+            for (auto const& node : settings->immediateChildren()) {
+                if (std::string(node.schema().name()) == "history-window") {
+                    windows.emplace_back(std::get<uint32_t>(node.asTerm().value()));
+                }
+            }
+            if (!windows.empty()) {
+                historyWindows = windows;
+            }
+        }
+
+        // +--rw timeseries-store?   boolean
+        auto const store(data.value().findPath(settings_xpath + "/timeseries-store"));
+        if (store) {
+            timeseriesStore = std::get<bool>(store->asTerm().value());
+        }
+
+        // +--rw timeseries-retention?   uint32
+        auto const retention(data.value().findPath(settings_xpath + "/timeseries-retention"));
+        if (retention) {
+            timeseriesRetention =
+                std::chrono::hours(std::get<uint32_t>(retention->asTerm().value()));
+        }
+
+        // +--rw operational-tree-build?   enumeration
+        auto const treeBuild(data.value().findPath(settings_xpath + "/operational-tree-build"));
+        if (treeBuild && treeBuild->asTerm().valueStr() == "nodes") {
+            operationalTreeBuild = TreeBuild::nodes;
+        }
+
+        // +--rw operational-mode?   enumeration
+        auto const mode(data.value().findPath(settings_xpath + "/operational-mode"));
+        if (mode && mode->asTerm().valueStr() == "push") {
+            operationalMode = OperationalMode::push;
+        }
+    }
+
+    static std::atomic<std::shared_ptr<PluginSettings const>> current;
+};
+
+std::atomic<std::shared_ptr<PluginSettings const>> PluginSettings::current;
+
+}  // namespace hardware
+
+#endif  // PLUGIN_SETTINGS_H
@@ -0,0 +1,134 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef REQUEST_FILTER_H
+#define REQUEST_FILTER_H
+
+#include <utils/globals.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace hardware {
+
+// Parts of the hardware tree selected by the XPath of an operational request. Anything that
+// can't be recognized selects the whole tree, the result is filtered by sysrepo anyway.
+struct RequestFilter {
+
+    RequestFilter() : inventory(true), sensors(true){};
+
+    static RequestFilter parse(std::optional<std::string_view> requestXPath) {
+        RequestFilter filter;
+        if (!requestXPath || requestXPath->find('|') != std::string_view::npos) {
+            return filter;
+        }
+
+        std::string_view path(requestXPath.value());
+        if (!consumeStep(path, "hardware")) {
+            return filter;
+        }
+
+        // +--ro last-change?   yang:date-and-time
+        if (consumeStep(path, "last-change")) {
+            filter.inventory = false;
+            filter.sensors = false;
+            return filter;
+        }
+        if (!consumeStep(path, "component")) {
+            return filter;
+        }
+        filter.componentName = consumeNamePredicate(path);
+
+        // +--ro sensor-data {hardware-sensor}?
+        if (consumeStep(path, "sensor-data")) {
+            filter.inventory = false;
+        }
+        return filter;
+    }
+
+    bool inventory;
+    bool sensors;
+    std::optional<std::string> componentName;
+
+private:
+    // Removes "/node" or "/ietf-hardware:node" from the beginning of the path
+    static bool consumeStep(std::string_view& path, std::string_view node) {
+        if (path.empty() || path.front() != '/') {
+            return false;
+        }
+        std::string_view step(path.substr(1));
+        std::string_view const prefix("ietf-hardware:");
+        if (step.substr(0, prefix.size()) == prefix) {
+            step.remove_prefix(prefix.size());
+        }
+        if (step.substr(0, node.size()) != node) {
+            return false;
+        }
+        step.remove_prefix(node.size());
+        if (!step.empty() && step.front() != '/' && step.front() != '[') {
+            return false;
+        }
+        path = step;
+        return true;
+    }
+
+    // Removes a [name='X'] predicate from the beginning of the path and returns X. Other
+    // predicates, also those combining name with others like [name='X' or name='Y'], select
+    // any component and are skipped.
+    static std::optional<std::string> consumeNamePredicate(std::string_view& path) {
+        std::optional<std::string> name;
+        while (!path.empty() && path.front() == '[') {
+            size_t const end(findPredicateEnd(path));
+            if (end == std::string_view::npos) {
+                path = std::string_view();
+                return std::nullopt;
+            }
+            std::string_view predicate(path.substr(1, end - 1));
+            path.remove_prefix(end + 1);
+
+            std::string_view const key("name=");
+            if (predicate.substr(0, key.size()) != key || name) {
+                continue;
+            }
+            predicate.remove_prefix(key.size());
+            if (predicate.size() < 2 || (predicate.front() != '\'' && predicate.front() != '"') ||
+                predicate.back() != predicate.front()) {
+                continue;
+            }
+            // a single literal, the quote doesn't appear in it
+            std::string_view const literal(predicate.substr(1, predicate.size() - 2));
+            if (literal.find(predicate.front()) == std::string_view::npos) {
+                name = std::string(literal);
+            }
+        }
+        return name;
+    }
+
+    static size_t findPredicateEnd(std::string_view path) {
+        char quote('\0');
+        for (size_t i = 1; i < path.size(); ++i) {
+            if (quote) {
+                if (path[i] == quote) {
+                    quote = '\0';
+                }
+            } else if (path[i] == '\'' || path[i] == '"') {
+                quote = path[i];
+            } else if (path[i] == ']') {
+                return i;
+            }
+        }
+        return std::string_view::npos;
+    }
+};
+
+}  // namespace hardware
+
+#endif  // REQUEST_FILTER_H
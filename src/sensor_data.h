@@ -12,6 +12,8 @@
 #define SENSOR_DATA_H
 
 #include <component_data.h>
+#include <hwmon_reader.h>
+#include <sensor_history.h>
 #include <utils/globals.h>
 
 #include <sensors/sensors.h>
@@ -66,6 +68,18 @@ struct Sensor : public ComponentData {
         yotta = 17
     };
 
+    // Everything needed for reading a sensor, resolved once from libsensors
+    struct Descriptor {
+        sensors_chip_name const* chip;
+        sensors_feature const* feature;
+        int subfeatureNumber;
+        ValueType valueType;
+        int32_t valuePrecision;
+        double scale;
+        // opened hwmon attribute of the sensor, if it is read directly from sysfs
+        HwmonChannel const* hwmon;
+    };
+
     static std::string getValueScaleString(ValueScale inputScale) {
         static std::array<std::string, 18> _{"units",  // unused
                                              "yocto", "zepto",  "atto",  "femto", "pico", "nano",
@@ -101,86 +115,223 @@ struct Sensor : public ComponentData {
                                bool /*setPhysicalID = false*/) const override {
         std::string sensorPath = mainXpath + "/component[name='" + name + "']";
         logMessage(SR_LL_DBG, "Setting values for component: " + name);
+        std::optional<libyang::DataNode> const component(createXpath(session, parent, sensorPath));
+        if (!component) {
+            return;
+        }
 
-        setXpath(session, parent, sensorPath + "/class", classType);
-        setXpath(session, parent, sensorPath + "/sensor-data/value", std::to_string(value));
-        setXpath(session, parent, sensorPath + "/sensor-data/value-type",
-                 getValueTypeString(valueType));
-        setXpath(session, parent, sensorPath + "/sensor-data/value-scale",
-                 getValueScaleString(valueScale));
-        setXpath(session, parent, sensorPath + "/sensor-data/value-precision",
-                 std::to_string(valuePrecision));
-        setXpath(session, parent, sensorPath + "/sensor-data/oper-status", "ok");
-        if (valueScale == Sensor::ValueScale::units) {
-            setXpath(session, parent, sensorPath + "/sensor-data/units-display",
-                     getValueTypeString(valueType));
-        } else {
-            std::string const unit =
-                getValueScaleString(valueScale) + " " + getValueTypeString(valueType);
-            setXpath(session, parent, sensorPath + "/sensor-data/units-display", unit);
+        setXpath(component.value(), "class", classType);
+        std::optional<libyang::DataNode> const sensorData(
+            setXpath(component.value(), "sensor-data"));
+        if (!sensorData) {
+            return;
         }
-        char timeString[100];
-        if (std::strftime(timeString, sizeof(timeString), "%FT%TZ",
-                          std::localtime(&valueTimestamp))) {
-            setXpath(session, parent, sensorPath + std::string("/sensor-data/value-timestamp"),
-                     timeString);
+        setXpath(sensorData.value(), "value", std::to_string(value));
+        setXpath(sensorData.value(), "value-type", getValueTypeString(valueType));
+        setXpath(sensorData.value(), "value-scale", getValueScaleString(valueScale));
+        setXpath(sensorData.value(), "value-precision", std::to_string(valuePrecision));
+        setXpath(sensorData.value(), "oper-status", "ok");
+        setXpath(sensorData.value(), "units-display", unitsDisplay());
+        std::optional<std::string> const timestamp(valueTimestampString());
+        if (timestamp) {
+            setXpath(sensorData.value(), "value-timestamp", timestamp.value());
+        }
+        setXpath(sensorData.value(), "value-update-rate", "0");
+        // +--ro hw-plugin:history* [window]
+        for (auto const& aggregate : history) {
+            std::optional<libyang::DataNode> const window(
+                setXpath(sensorData.value(), "hardware-plugin-augment:history[window='" +
+                                                 std::to_string(aggregate.window.count()) + "']"));
+            if (window) {
+                setXpath(window.value(), "samples", std::to_string(aggregate.samples));
+                setXpath(window.value(), "minimum", std::to_string(aggregate.minimum));
+                setXpath(window.value(), "maximum", std::to_string(aggregate.maximum));
+                setXpath(window.value(), "average", std::to_string(aggregate.average));
+            }
         }
-        setXpath(session, parent, sensorPath + std::string("/sensor-data/value-update-rate"), "0");
         if (!sensorThresholds.empty()) {
-            setXpath(
-                session, parent,
-                sensorPath +
-                    std::string("/sensor-notifications-augment:sensor-notifications/poll-interval"),
-                std::to_string(ComponentData::pollInterval));
-            std::string sensorThresholdPath(
-                sensorPath + "/sensor-notifications-augment:sensor-notifications/threshold[name='");
+            std::optional<libyang::DataNode> const notifications(setXpath(
+                component.value(), "sensor-notifications-augment:sensor-notifications"));
+            if (!notifications) {
+                return;
+            }
+            setXpath(notifications.value(), "poll-interval",
+                     std::to_string(ComponentData::pollInterval));
+            if (minPollInterval) {
+                setXpath(notifications.value(), "min-poll-interval",
+                         std::to_string(minPollInterval.value()));
+            }
+            if (maxPollInterval) {
+                setXpath(notifications.value(), "max-poll-interval",
+                         std::to_string(maxPollInterval.value()));
+            }
             for (auto const& sens : sensorThresholds) {
-                setXpath(session, parent, sensorThresholdPath + sens->name + "']/value",
-                         std::to_string(sens->value));
+                std::optional<libyang::DataNode> const threshold(
+                    setXpath(notifications.value(), "threshold[name='" + sens->name + "']"));
+                if (!threshold) {
+                    continue;
+                }
+                setXpath(threshold.value(), "value", std::to_string(sens->value));
+                setXpath(threshold.value(), "hysteresis", std::to_string(sens->hysteresis));
+                setXpath(threshold.value(), "hold-time", std::to_string(sens->holdTime.count()));
             }
         }
     }
 
-    static std::optional<int32_t> getValueFromSubfeature(sensors_chip_name const* cn,
-                                                         sensors_feature const* feature,
-                                                         sensors_subfeature_type type,
-                                                         int32_t precision) {
-        double val;
-        std::optional<int32_t> result;
+    void writeJson(JsonWriter& writer, bool /*setPhysicalID = false*/) const override {
+        writer.StartObject();
+        writeJsonMember(writer, "name", name);
+        writeJsonMember(writer, "class", classType);
+
+        writer.Key("sensor-data");
+        writer.StartObject();
+        writer.Key("value");
+        writer.Int(value);
+        writeJsonMember(writer, "value-type", getValueTypeString(valueType));
+        writeJsonMember(writer, "value-scale", getValueScaleString(valueScale));
+        writer.Key("value-precision");
+        writer.Int(valuePrecision);
+        writeJsonMember(writer, "oper-status", "ok");
+        writeJsonMember(writer, "units-display", unitsDisplay());
+        std::optional<std::string> const timestamp(valueTimestampString());
+        if (timestamp) {
+            writeJsonMember(writer, "value-timestamp", timestamp.value());
+        }
+        writer.Key("value-update-rate");
+        writer.Uint(0);
+        if (!history.empty()) {
+            writer.Key("hardware-plugin-augment:history");
+            writer.StartArray();
+            for (auto const& aggregate : history) {
+                writer.StartObject();
+                writer.Key("window");
+                writer.Uint(aggregate.window.count());
+                writer.Key("samples");
+                writer.Uint(aggregate.samples);
+                writer.Key("minimum");
+                writer.Int(aggregate.minimum);
+                writer.Key("maximum");
+                writer.Int(aggregate.maximum);
+                writer.Key("average");
+                writer.Int(aggregate.average);
+                writer.EndObject();
+            }
+            writer.EndArray();
+        }
+        writer.EndObject();
+
+        if (!sensorThresholds.empty()) {
+            writer.Key("sensor-notifications-augment:sensor-notifications");
+            writer.StartObject();
+            writer.Key("poll-interval");
+            writer.Uint(ComponentData::pollInterval);
+            if (minPollInterval) {
+                writer.Key("min-poll-interval");
+                writer.Uint(minPollInterval.value());
+            }
+            if (maxPollInterval) {
+                writer.Key("max-poll-interval");
+                writer.Uint(maxPollInterval.value());
+            }
+            writer.Key("threshold");
+            writer.StartArray();
+            for (auto const& sens : sensorThresholds) {
+                writer.StartObject();
+                writeJsonMember(writer, "name", sens->name);
+                writer.Key("value");
+                writer.Int(sens->value);
+                writer.Key("hysteresis");
+                writer.Int(sens->hysteresis);
+                writer.Key("hold-time");
+                writer.Uint(sens->holdTime.count());
+                writer.EndObject();
+            }
+            writer.EndArray();
+            writer.EndObject();
+        }
+        writer.EndObject();
+    }
+
+    std::string unitsDisplay() const {
+        if (valueScale == Sensor::ValueScale::units) {
+            return getValueTypeString(valueType);
+        }
+        return getValueScaleString(valueScale) + " " + getValueTypeString(valueType);
+    }
+
+    std::optional<std::string> valueTimestampString() const {
+        char timeString[100];
+        if (std::strftime(timeString, sizeof(timeString), "%FT%TZ",
+                          std::localtime(&valueTimestamp))) {
+            return std::string(timeString);
+        }
+        return std::nullopt;
+    }
+
+    // Resolves the input subfeature of a libsensors feature, features that don't provide a
+    // readable input value aren't exposed
+    static std::optional<Descriptor> describeFeature(sensors_chip_name const* cn,
+                                                     sensors_feature const* feature) {
+        Descriptor descriptor{cn, feature, 0, ValueType::other, 0, 1, nullptr};
+        sensors_subfeature_type type;
+        switch (feature->type) {
+        case SENSORS_FEATURE_IN:
+            type = SENSORS_SUBFEATURE_IN_INPUT;
+            descriptor.valueType = ValueType::volts_dc;
+            descriptor.valuePrecision = 3;
+            break;
+        case SENSORS_FEATURE_CURR:
+            type = SENSORS_SUBFEATURE_CURR_INPUT;
+            descriptor.valueType = ValueType::amperes;
+            descriptor.valuePrecision = 3;
+            break;
+        case SENSORS_FEATURE_TEMP:
+            type = SENSORS_SUBFEATURE_TEMP_INPUT;
+            descriptor.valueType = ValueType::celsius;
+            break;
+        case SENSORS_FEATURE_FAN:
+            type = SENSORS_SUBFEATURE_FAN_INPUT;
+            descriptor.valueType = ValueType::rpm;
+            break;
+        case SENSORS_FEATURE_POWER:
+            type = SENSORS_SUBFEATURE_POWER_INPUT;
+            descriptor.valueType = ValueType::watts;
+            break;
+        case SENSORS_FEATURE_HUMIDITY:
+            type = SENSORS_SUBFEATURE_HUMIDITY_INPUT;
+            descriptor.valueType = ValueType::percent_rh;
+            break;
+        default:
+            return std::nullopt;
+        }
+
         sensors_subfeature const* subf = sensors_get_subfeature(cn, feature, type);
         if (!subf) {
-            return result;
+            return std::nullopt;
         }
-        if (subf->flags & SENSORS_MODE_R) {
-            int rc = sensors_get_value(cn, subf->number, &val);
-            if (rc < 0) {
-                logMessage(SR_LL_WRN, std::string("Couldn't get sensor value. Error code: ") +
-                                          std::to_string(rc));
-            } else {
-                logMessage(SR_LL_DBG, std::string("Got sensor: ") + cn->prefix + "/" +
-                                          feature->name + " value " + std::to_string(val));
-                result = val * std::pow(10, precision);
-            }
-        } else {
+        if (!(subf->flags & SENSORS_MODE_R)) {
             logMessage(SR_LL_WRN, std::string("Couldn't read sensor: ") + cn->prefix + "/" +
                                       feature->name + "/" + subf->name);
+            return std::nullopt;
         }
-
-        return result;
+        descriptor.subfeatureNumber = subf->number;
+        descriptor.scale = std::pow(10, descriptor.valuePrecision);
+        return descriptor;
     }
 
-    bool setValueFromSubfeature(sensors_chip_name const* cn,
-                                sensors_feature const* feature,
-                                sensors_subfeature_type type,
-                                int32_t precision) {
-        std::optional<int32_t> val = getValueFromSubfeature(cn, feature, type, precision);
-        if (!val) {
-            return false;
+    static std::optional<int32_t> getValueFromDescriptor(Descriptor const& descriptor) {
+        double val;
+        std::optional<int32_t> result;
+        int rc = sensors_get_value(descriptor.chip, descriptor.subfeatureNumber, &val);
+        if (rc < 0) {
+            logMessage(SR_LL_WRN, std::string("Couldn't get sensor value. Error code: ") +
+                                      std::to_string(rc));
         } else {
-            value = val.value();
+            logMessage(SR_LL_DBG, std::string("Got sensor: ") + descriptor.chip->prefix + "/" +
+                                      descriptor.feature->name + " value " + std::to_string(val));
+            result = val * descriptor.scale;
         }
-
-        return true;
+        return result;
     }
 
     int32_t value;
@@ -188,6 +339,7 @@ struct Sensor : public ComponentData {
     ValueScale valueScale;
     int32_t valuePrecision;
     std::time_t valueTimestamp;
+    std::list<HistoryAggregate> history;
 };
 
 }  // namespace hardware
@@ -0,0 +1,181 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef SENSOR_HISTORY_H
+#define SENSOR_HISTORY_H
+
+#include <utils/globals.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hardware {
+
+// Minimum, maximum and average of the samples of a sensor within a window
+struct HistoryAggregate {
+    std::chrono::seconds window;
+    uint32_t samples;
+    int32_t minimum;
+    int32_t maximum;
+    int32_t average;
+};
+
+// Sample history of all sensors, kept as aggregates over configurable windows. Every window of
+// every sensor is a ring of HISTORY_BUCKETS buckets, each covering 1/HISTORY_BUCKETS of the
+// window, so recording a sample only updates a single bucket and a window is aggregated from a
+// fixed number of buckets. The buckets are stored as structure of arrays over all sensors and
+// windows, aggregating a window reads contiguous memory.
+struct SensorHistory {
+
+    using Clock = std::chrono::system_clock;
+
+    // Sensors that are kept keep their history unless the windows change
+    void configure(std::list<std::string> const& sensorNames,
+                   std::vector<std::chrono::seconds> const& windows) {
+        std::lock_guard lk(mHistoryMtx);
+        bool const sameWindows(windows == mWindows);
+        std::unordered_map<std::string, size_t> slots;
+        for (auto const& name : sensorNames) {
+            slots.emplace(name, slots.size());
+        }
+
+        Buckets buckets;
+        buckets.resize(windows.size() * slots.size() * HISTORY_BUCKETS);
+        if (sameWindows) {
+            for (auto const& [name, slot] : slots) {
+                auto const& previous = mSlots.find(name);
+                if (previous == mSlots.end()) {
+                    continue;
+                }
+                for (size_t w = 0; w < windows.size(); ++w) {
+                    buckets.copyRing(mBuckets, index(w, previous->second, 0, mSlots.size()),
+                                     index(w, slot, 0, slots.size()));
+                }
+            }
+        }
+        mSlots = std::move(slots);
+        mWindows = windows;
+        mBuckets = std::move(buckets);
+    }
+
+    void record(std::string const& sensorName, int32_t value, Clock::time_point timestamp) {
+        std::lock_guard lk(mHistoryMtx);
+        auto const& slot = mSlots.find(sensorName);
+        if (slot == mSlots.end()) {
+            return;
+        }
+        int64_t const time(toMilliseconds(timestamp));
+        for (size_t w = 0; w < mWindows.size(); ++w) {
+            int64_t const epoch(time / bucketWidth(w));
+            size_t const i(index(w, slot->second, epoch % HISTORY_BUCKETS, mSlots.size()));
+            if (mBuckets.epoch[i] != epoch) {
+                mBuckets.epoch[i] = epoch;
+                mBuckets.minimum[i] = value;
+                mBuckets.maximum[i] = value;
+                mBuckets.sum[i] = 0;
+                mBuckets.count[i] = 0;
+            }
+            mBuckets.minimum[i] = std::min(mBuckets.minimum[i], value);
+            mBuckets.maximum[i] = std::max(mBuckets.maximum[i], value);
+            mBuckets.sum[i] += value;
+            mBuckets.count[i]++;
+        }
+    }
+
+    // Aggregates of every window that has samples
+    std::list<HistoryAggregate> aggregate(std::string const& sensorName,
+                                          Clock::time_point now) const {
+        std::list<HistoryAggregate> result;
+        std::lock_guard lk(mHistoryMtx);
+        auto const& slot = mSlots.find(sensorName);
+        if (slot == mSlots.end()) {
+            return result;
+        }
+        int64_t const time(toMilliseconds(now));
+        for (size_t w = 0; w < mWindows.size(); ++w) {
+            int64_t const oldest(time / bucketWidth(w) - HISTORY_BUCKETS + 1);
+            size_t const first(index(w, slot->second, 0, mSlots.size()));
+            int64_t sum(0);
+            uint32_t count(0);
+            int32_t minimum(std::numeric_limits<int32_t>::max());
+            int32_t maximum(std::numeric_limits<int32_t>::min());
+            for (size_t i = first; i < first + HISTORY_BUCKETS; ++i) {
+                if (mBuckets.count[i] == 0 || mBuckets.epoch[i] < oldest) {
+                    continue;
+                }
+                sum += mBuckets.sum[i];
+                count += mBuckets.count[i];
+                minimum = std::min(minimum, mBuckets.minimum[i]);
+                maximum = std::max(maximum, mBuckets.maximum[i]);
+            }
+            if (count) {
+                result.emplace_back(HistoryAggregate{mWindows[w], count, minimum, maximum,
+                                                     static_cast<int32_t>(sum / count)});
+            }
+        }
+        return result;
+    }
+
+private:
+    struct Buckets {
+        void resize(size_t size) {
+            epoch.assign(size, -1);
+            minimum.assign(size, 0);
+            maximum.assign(size, 0);
+            sum.assign(size, 0);
+            count.assign(size, 0);
+        }
+
+        void copyRing(Buckets const& other, size_t from, size_t to) {
+            std::copy_n(other.epoch.begin() + from, HISTORY_BUCKETS, epoch.begin() + to);
+            std::copy_n(other.minimum.begin() + from, HISTORY_BUCKETS, minimum.begin() + to);
+            std::copy_n(other.maximum.begin() + from, HISTORY_BUCKETS, maximum.begin() + to);
+            std::copy_n(other.sum.begin() + from, HISTORY_BUCKETS, sum.begin() + to);
+            std::copy_n(other.count.begin() + from, HISTORY_BUCKETS, count.begin() + to);
+        }
+
+        std::vector<int64_t> epoch;
+        std::vector<int32_t> minimum;
+        std::vector<int32_t> maximum;
+        std::vector<int64_t> sum;
+        std::vector<uint32_t> count;
+    };
+
+    static size_t index(size_t window, size_t slot, size_t bucket, size_t slots) {
+        return (window * slots + slot) * HISTORY_BUCKETS + bucket;
+    }
+
+    static int64_t toMilliseconds(Clock::time_point timestamp) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch())
+            .count();
+    }
+
+    int64_t bucketWidth(size_t window) const {
+        return std::max<int64_t>(
+            1, std::chrono::duration_cast<std::chrono::milliseconds>(mWindows[window]).count() /
+                   HISTORY_BUCKETS);
+    }
+
+    mutable std::mutex mHistoryMtx;
+    std::unordered_map<std::string, size_t> mSlots;
+    std::vector<std::chrono::seconds> mWindows;
+    Buckets mBuckets;
+};
+
+}  // namespace hardware
+
+#endif  // SENSOR_HISTORY_H
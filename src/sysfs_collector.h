@@ -0,0 +1,294 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef SYSFS_COLLECTOR_H
+#define SYSFS_COLLECTOR_H
+
+#include <component_data.h>
+#include <inventory_collector.h>
+#include <utils/globals.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <unistd.h>
+#include <vector>
+
+namespace hardware {
+
+// Native inventory collector reading the DMI tables, PCI devices, network interfaces, block
+// devices and CPU packages straight from sysfs, without running any external tool.
+struct SysfsCollector : public InventoryCollector {
+
+    using Path = std::filesystem::path;
+
+    std::string name() const override {
+        return "sysfs";
+    }
+
+    bool collect(ComponentMap& hwComponents) override {
+        std::error_code ec;
+        if (!std::filesystem::is_directory(SYSFS_CPU_LOCATION, ec)) {
+            logMessage(SR_LL_ERR, "Can't access: " SYSFS_CPU_LOCATION);
+            return false;
+        }
+
+        std::string const root(collectSystem(hwComponents));
+        std::string const core(collectBoard(hwComponents, root));
+        collectProcessors(hwComponents, core);
+
+        // devices are attached to the PCI device found in their sysfs path, if any
+        std::map<Path, std::string> pciDevices;
+        collectPciDevices(hwComponents, core, pciDevices);
+        collectNetworkInterfaces(hwComponents, core, pciDevices);
+        collectBlockDevices(hwComponents, core, pciDevices);
+        return true;
+    }
+
+    static std::optional<std::string> readAttribute(Path const& path) {
+        std::ifstream ifs(path);
+        std::string value;
+        if (ifs.fail() || !std::getline(ifs, value)) {
+            return std::nullopt;
+        }
+        value.erase(value.find_last_not_of(" \t\n") + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        if (value.empty()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    // Directory entries sorted by name, so components keep their position across collections
+    static std::vector<Path> listDirectory(Path const& directory) {
+        std::error_code ec;
+        std::vector<Path> entries;
+        for (auto const& entry : std::filesystem::directory_iterator(directory, ec)) {
+            entries.emplace_back(entry.path());
+        }
+        std::sort(entries.begin(), entries.end());
+        return entries;
+    }
+
+    // Version of the kernel module driving the device, if it reports one
+    static std::optional<std::string> readDriverVersion(Path const& devicePath) {
+        return readAttribute(devicePath / "driver" / "module" / "version");
+    }
+
+private:
+    static std::string addComponent(ComponentMap& hwComponents,
+                                    std::shared_ptr<ComponentData> component,
+                                    std::string const& parentName) {
+        // Check if a node with the current name exists, if so rename the current one
+        if (hwComponents.find(component->name) != hwComponents.end()) {
+            component->name = parentName + ":" + component->name;
+        }
+
+        // +--rw parent?           -> ../../component/name
+        // +--rw parent-rel-pos?   int32
+        std::shared_ptr<ComponentData> parent;
+        if (!parentName.empty() && hwComponents.find(parentName) != hwComponents.end()) {
+            parent = hwComponents[parentName];
+            component->parentName = parentName;
+            component->parent_rel_pos = parent->children.size();
+        }
+
+        // Filter discovered component through configuration values
+        InventoryCollector::applyConfigData(component);
+
+        // +--ro contains-child*   -> ../../component/name
+        if (parent) {
+            parent->children.emplace_back(component->name);
+        }
+        hwComponents.insert(std::make_pair(component->name, component));
+        return component->name;
+    }
+
+    static std::string collectSystem(ComponentMap& hwComponents) {
+        Path const dmi(SYSFS_DMI_LOCATION);
+        char hostname[256] = {};
+        if (gethostname(hostname, sizeof(hostname) - 1) != 0 || hostname[0] == '\0') {
+            std::strcpy(hostname, "system");
+        }
+
+        auto component(std::make_shared<ComponentData>(hostname, "iana-hardware:chassis"));
+        component->description = "Computer";
+        component->mfgName = readAttribute(dmi / "sys_vendor");
+        component->modelName = readAttribute(dmi / "product_name");
+        component->hardwareRev = readAttribute(dmi / "product_version");
+        component->serial = readAttribute(dmi / "product_serial");
+        component->uuid = readAttribute(dmi / "product_uuid");
+        return addComponent(hwComponents, component, std::string());
+    }
+
+    static std::string collectBoard(ComponentMap& hwComponents, std::string const& root) {
+        Path const dmi(SYSFS_DMI_LOCATION);
+        auto component(std::make_shared<ComponentData>("core"));
+        component->description = "Motherboard";
+        component->mfgName = readAttribute(dmi / "board_vendor");
+        component->modelName = readAttribute(dmi / "board_name");
+        component->hardwareRev = readAttribute(dmi / "board_version");
+        component->serial = readAttribute(dmi / "board_serial");
+        component->firmwareRev = readAttribute(dmi / "bios_version");
+        return addComponent(hwComponents, component, root);
+    }
+
+    static void collectProcessors(ComponentMap& hwComponents, std::string const& core) {
+        std::error_code ec;
+        std::set<int32_t> packages;
+        for (auto const& entry : std::filesystem::directory_iterator(SYSFS_CPU_LOCATION, ec)) {
+            std::string const cpu(entry.path().filename());
+            if (cpu.rfind("cpu", 0) != 0 || cpu.size() == 3 ||
+                !std::all_of(cpu.begin() + 3, cpu.end(), ::isdigit)) {
+                continue;
+            }
+            auto const package(readAttribute(entry.path() / "topology" / "physical_package_id"));
+            try {
+                packages.insert(package ? std::stoi(package.value()) : 0);
+            } catch (std::exception const& e) {
+                logMessage(SR_LL_WRN, "Invalid package id for: " + cpu);
+            }
+        }
+
+        for (int32_t package : packages) {
+            auto component(std::make_shared<ComponentData>("cpu:" + std::to_string(package),
+                                                           "iana-hardware:cpu"));
+            component->description = "CPU";
+            addComponent(hwComponents, component, core);
+        }
+    }
+
+    static void collectPciDevices(ComponentMap& hwComponents,
+                                  std::string const& core,
+                                  std::map<Path, std::string>& pciDevices) {
+        // bridges have to be added before the devices behind them, their paths are shorter
+        std::error_code ec;
+        std::vector<Path> devices;
+        for (auto const& entry : listDirectory(SYSFS_PCI_LOCATION)) {
+            devices.emplace_back(std::filesystem::canonical(entry, ec));
+        }
+        std::sort(devices.begin(), devices.end(), [](Path const& lhs, Path const& rhs) {
+            if (lhs.native().size() != rhs.native().size()) {
+                return lhs.native().size() < rhs.native().size();
+            }
+            return lhs < rhs;
+        });
+
+        for (auto const& device : devices) {
+            if (device.empty()) {
+                continue;
+            }
+            auto component(
+                std::make_shared<ComponentData>("pci@" + device.filename().string()));
+            component->description = getPciClassDescription(readAttribute(device / "class"));
+            component->mfgName = readAttribute(device / "vendor");
+            component->modelName = readAttribute(device / "device");
+            component->hardwareRev = readAttribute(device / "revision");
+            component->softwareRev = readDriverVersion(device);
+            pciDevices[device] =
+                addComponent(hwComponents, component, findParent(device, core, pciDevices));
+        }
+    }
+
+    static void collectNetworkInterfaces(ComponentMap& hwComponents,
+                                         std::string const& core,
+                                         std::map<Path, std::string> const& pciDevices) {
+        std::error_code ec;
+        for (auto const& entry : listDirectory(SYSFS_NET_LOCATION)) {
+            // virtual interfaces have no backing device
+            Path const device(std::filesystem::canonical(entry / "device", ec));
+            if (ec) {
+                ec.clear();
+                continue;
+            }
+            auto component(std::make_shared<ComponentData>(entry.filename().string(),
+                                                           "iana-hardware:port"));
+            component->description = "Network interface";
+            component->serial = readAttribute(entry / "address");
+            component->softwareRev = readDriverVersion(device);
+            addComponent(hwComponents, component, findParent(device, core, pciDevices));
+        }
+    }
+
+    static void collectBlockDevices(ComponentMap& hwComponents,
+                                    std::string const& core,
+                                    std::map<Path, std::string> const& pciDevices) {
+        std::error_code ec;
+        for (auto const& entry : listDirectory(SYSFS_BLOCK_LOCATION)) {
+            // loop, ram and device-mapper devices have no backing device
+            Path const device(std::filesystem::canonical(entry / "device", ec));
+            if (ec) {
+                ec.clear();
+                continue;
+            }
+            auto component(std::make_shared<ComponentData>(entry.filename().string(),
+                                                           "iana-hardware:storage-drive"));
+            component->description = "Disk";
+            component->mfgName = readAttribute(device / "vendor");
+            component->modelName = readAttribute(device / "model");
+            component->hardwareRev = readAttribute(device / "rev");
+            if (!component->hardwareRev) {
+                component->hardwareRev = readAttribute(device / "firmware_rev");
+            }
+            component->serial = readAttribute(device / "serial");
+            addComponent(hwComponents, component, findParent(device, core, pciDevices));
+        }
+    }
+
+    // Closest PCI device up the sysfs device path, falling back to the motherboard
+    static std::string findParent(Path const& device,
+                                  std::string const& core,
+                                  std::map<Path, std::string> const& pciDevices) {
+        for (Path path = device; path.has_relative_path();
+             path = path.parent_path()) {
+            auto const& found = pciDevices.find(path);
+            if (found != pciDevices.end()) {
+                return found->second;
+            }
+        }
+        return core;
+    }
+
+    static std::optional<std::string> getPciClassDescription(
+        std::optional<std::string> const& classCode) {
+        static std::unordered_map<uint32_t, std::string> const _{
+            {0x01, "Mass storage controller"},
+            {0x02, "Network controller"},
+            {0x03, "Display controller"},
+            {0x04, "Multimedia controller"},
+            {0x05, "Memory controller"},
+            {0x06, "Bridge"},
+            {0x07, "Communication controller"},
+            {0x08, "System peripheral"},
+            {0x0c, "Serial bus controller"},
+            {0x12, "Processing accelerator"}};
+
+        if (!classCode) {
+            return std::nullopt;
+        }
+        try {
+            auto const found = _.find(std::stoul(classCode.value(), nullptr, 16) >> 16);
+            if (found != _.end()) {
+                return found->second;
+            }
+        } catch (std::exception const& e) {
+            logMessage(SR_LL_WRN, "Invalid PCI class: " + classCode.value());
+        }
+        return std::nullopt;
+    }
+};
+
+}  // namespace hardware
+
+#endif  // SYSFS_COLLECTOR_H
@@ -0,0 +1,71 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef THRESHOLD_STATE_H
+#define THRESHOLD_STATE_H
+
+#include <component_data.h>
+#include <notification_queue.h>
+
+#include <chrono>
+#include <memory>
+#include <optional>
+
+namespace hardware {
+
+// Edge-triggered state of a configured threshold. A sensor is above its threshold once its value
+// exceeds it and below it again once the value drops under the threshold minus its hysteresis.
+// A transition is only reported after the value stayed on the other side for the hold time.
+struct ThresholdState {
+
+    using Clock = std::chrono::steady_clock;
+
+    enum class Crossing { rising, falling };
+
+    ThresholdState(SensorThreshold const& threshold)
+        : above(false), value(threshold.value), hysteresis(threshold.hysteresis),
+          holdTime(threshold.holdTime), pending(std::make_shared<PendingNotification>()){};
+
+    // The state starts over when the threshold it was built for has been reconfigured
+    bool matches(SensorThreshold const& threshold) const {
+        return value == threshold.value && hysteresis == threshold.hysteresis &&
+               holdTime == threshold.holdTime;
+    }
+
+    std::optional<Crossing> evaluate(int32_t sensorValue, Clock::time_point now) {
+        bool const crossed(above ? int64_t(sensorValue) < int64_t(value) - hysteresis
+                                 : sensorValue > value);
+        if (!crossed) {
+            pendingSince = std::nullopt;
+            return std::nullopt;
+        }
+        if (!pendingSince) {
+            pendingSince = now;
+        }
+        if (now - pendingSince.value() < holdTime) {
+            return std::nullopt;
+        }
+        pendingSince = std::nullopt;
+        above = !above;
+        return above ? Crossing::rising : Crossing::falling;
+    }
+
+    bool above;
+    std::optional<Clock::time_point> pendingSince;
+    int32_t value;
+    int32_t hysteresis;
+    std::chrono::seconds holdTime;
+    // notification of this threshold waiting for delivery, when notifications are coalesced
+    std::shared_ptr<PendingNotification> pending;
+};
+
+}  // namespace hardware
+
+#endif  // THRESHOLD_STATE_H
@@ -0,0 +1,427 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef TIMESERIES_STORE_H
+#define TIMESERIES_STORE_H
+
+#include <utils/globals.h>
+#include <utils/gorilla.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace hardware {
+
+// Append-only store of sensor samples in memory mapped segment files. A segment is divided into
+// chunks of TIMESERIES_CHUNK_SIZE bytes, the first one describes the segment and every other one
+// holds a Gorilla compressed run of samples of a single sensor. Each sensor appends to its own
+// chunk until it is full and then allocates the next free chunk of the segment. A chunk header
+// is only updated after its samples have been written, so a chunk is readable at any time.
+// A new segment is started at least TIMESERIES_SEGMENTS_PER_RETENTION times per retention time,
+// and a segment is deleted on the first append after all of its samples have become older than
+// the retention time.
+// Sensors with names longer than TIMESERIES_NAME_SIZE aren't persisted.
+struct TimeSeriesStore {
+
+    using Clock = std::chrono::system_clock;
+    using Path = std::filesystem::path;
+    using Samples = std::vector<std::pair<int64_t, int32_t>>;
+
+    TimeSeriesStore() : mRetention(DEFAULT_TIMESERIES_RETENTION), mSegmentStart(0){};
+
+    TimeSeriesStore(TimeSeriesStore const&) = delete;
+    void operator=(TimeSeriesStore const&) = delete;
+
+    ~TimeSeriesStore() {
+        close();
+    }
+
+    bool open(Path const& directory, std::chrono::hours retention) {
+        std::lock_guard lk(mStoreMtx);
+        mRetention = retention;
+        int64_t const now(toMilliseconds(Clock::now()));
+        if (mSegment && mDirectory == directory) {
+            removeExpiredSegments(now);
+            return true;
+        }
+        unmap();
+        mDirectory = directory;
+        std::error_code ec;
+        std::filesystem::create_directories(mDirectory, ec);
+        if (ec) {
+            logMessage(SR_LL_WRN, "Can't create time-series directory " + mDirectory.string() +
+                                      ": " + ec.message());
+            return false;
+        }
+        std::vector<Path> const segments(listSegments());
+        std::optional<int64_t> const lastStart(
+            segments.empty() ? std::nullopt : segmentStart(segments.back()));
+        if (lastStart && now - lastStart.value() < rotationInterval() &&
+            mapSegment(segments.back(), false)) {
+            mSegmentStart = lastStart.value();
+            removeExpiredSegments(now);
+            return true;
+        }
+        return startSegment(now);
+    }
+
+    void close() {
+        std::lock_guard lk(mStoreMtx);
+        unmap();
+    }
+
+    void append(std::string const& sensorName, Clock::time_point timestamp, int32_t value) {
+        std::lock_guard lk(mStoreMtx);
+        if (!mSegment) {
+            return;
+        }
+        if (sensorName.size() > TIMESERIES_NAME_SIZE) {
+            if (mUnstoredNames.insert(sensorName).second) {
+                logMessage(SR_LL_WRN, "Samples of " + sensorName + " aren't persisted, names " +
+                                          "are limited to " +
+                                          std::to_string(TIMESERIES_NAME_SIZE) + " characters.");
+            }
+            return;
+        }
+        int64_t const time(toMilliseconds(timestamp));
+        if (time - mSegmentStart >= rotationInterval()) {
+            if (!startSegment(time)) {
+                return;
+            }
+        } else if (mNextExpiry && time >= mNextExpiry.value()) {
+            removeExpiredSegments(time);
+        }
+        auto chunk = mOpenChunks.find(sensorName);
+        if (chunk == mOpenChunks.end() || !chunk->second.encoder.append(time, value)) {
+            if (chunk != mOpenChunks.end()) {
+                mOpenChunks.erase(chunk);
+            }
+            std::optional<size_t> index(allocateChunk(sensorName, time));
+            if (!index) {
+                if (!startSegment(time)) {
+                    return;
+                }
+                index = allocateChunk(sensorName, time);
+                if (!index) {
+                    return;
+                }
+            }
+            chunk = mOpenChunks
+                        .emplace(sensorName,
+                                 OpenChunk{index.value(),
+                                           GorillaEncoder(payload(mSegment->data, index.value()),
+                                                          PAYLOAD_SIZE * 8)})
+                        .first;
+            chunk->second.encoder.append(time, value);
+        }
+        ChunkHeader* header(chunkHeader(mSegment->data, chunk->second.index));
+        header->bitLength = chunk->second.encoder.bitLength();
+        header->lastTimestamp = time;
+        header->count = chunk->second.encoder.count();
+    }
+
+    // Samples of the given sensors, or of all sensors if none are given, within [from, to]. Only
+    // the list of segments and the written part of the current segment are taken under the lock,
+    // closed segments are never written again and are decoded while samples are appended.
+    std::map<std::string, Samples> query(std::set<std::string> const& sensorNames,
+                                         Clock::time_point from,
+                                         Clock::time_point to) const {
+        std::map<std::string, Samples> result;
+        int64_t const begin(toMilliseconds(from));
+        int64_t const end(toMilliseconds(to));
+        std::vector<Path> segments;
+        std::vector<uint8_t> current;
+        {
+            std::lock_guard lk(mStoreMtx);
+            segments = listSegments();
+            if (mSegment) {
+                segments.erase(std::remove(segments.begin(), segments.end(), mSegment->path),
+                               segments.end());
+                auto const* segment(reinterpret_cast<SegmentHeader const*>(mSegment->data));
+                size_t const used(std::min<size_t>(segment->allocatedChunks, CHUNK_COUNT) *
+                                  TIMESERIES_CHUNK_SIZE);
+                current.assign(mSegment->data, mSegment->data + used);
+            }
+        }
+
+        for (auto const& path : segments) {
+            int const fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+            if (fd < 0) {
+                // removed as expired in the meantime
+                continue;
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size < TIMESERIES_CHUNK_SIZE) {
+                ::close(fd);
+                continue;
+            }
+            size_t const size(std::min<size_t>(st.st_size, TIMESERIES_SEGMENT_SIZE));
+            void* data(mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0));
+            ::close(fd);
+            if (data == MAP_FAILED) {
+                continue;
+            }
+            readSegment(static_cast<uint8_t const*>(data), size, sensorNames, begin, end, result);
+            munmap(data, size);
+        }
+        if (!current.empty()) {
+            readSegment(current.data(), current.size(), sensorNames, begin, end, result);
+        }
+        for (auto& [_, samples] : result) {
+            std::sort(samples.begin(), samples.end());
+        }
+        return result;
+    }
+
+private:
+    static constexpr uint32_t SEGMENT_MAGIC = 0x48575453;  // "HWTS"
+    static constexpr uint32_t CHUNK_MAGIC = 0x4857434b;  // "HWCK"
+    static constexpr uint32_t VERSION = 1;
+
+    struct SegmentHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t chunkSize;
+        uint32_t allocatedChunks;
+    };
+
+    struct ChunkHeader {
+        uint32_t magic;
+        uint32_t count;
+        uint32_t bitLength;
+        uint16_t nameLength;
+        uint16_t reserved;
+        int64_t firstTimestamp;
+        int64_t lastTimestamp;
+        char name[TIMESERIES_NAME_SIZE];
+    };
+
+    static constexpr size_t CHUNK_COUNT = TIMESERIES_SEGMENT_SIZE / TIMESERIES_CHUNK_SIZE;
+    static constexpr size_t PAYLOAD_SIZE = TIMESERIES_CHUNK_SIZE - sizeof(ChunkHeader);
+    static_assert(sizeof(SegmentHeader) <= TIMESERIES_CHUNK_SIZE);
+    static_assert(PAYLOAD_SIZE * 8 > GorillaEncoder::MAX_SAMPLE_BITS);
+
+    struct MappedSegment {
+        Path path;
+        uint8_t* data;
+        size_t size;
+    };
+
+    struct OpenChunk {
+        size_t index;
+        GorillaEncoder encoder;
+    };
+
+    static int64_t toMilliseconds(Clock::time_point timestamp) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch())
+            .count();
+    }
+
+    static ChunkHeader* chunkHeader(uint8_t* data, size_t index) {
+        return reinterpret_cast<ChunkHeader*>(data + index * TIMESERIES_CHUNK_SIZE);
+    }
+
+    static uint8_t* payload(uint8_t* data, size_t index) {
+        return data + index * TIMESERIES_CHUNK_SIZE + sizeof(ChunkHeader);
+    }
+
+    static void readSegment(uint8_t const* data,
+                            size_t size,
+                            std::set<std::string> const& sensorNames,
+                            int64_t begin,
+                            int64_t end,
+                            std::map<std::string, Samples>& result) {
+        auto const* segment(reinterpret_cast<SegmentHeader const*>(data));
+        if (size < TIMESERIES_CHUNK_SIZE || segment->magic != SEGMENT_MAGIC ||
+            segment->version != VERSION || segment->chunkSize != TIMESERIES_CHUNK_SIZE) {
+            return;
+        }
+        size_t const chunks(
+            std::min<size_t>(segment->allocatedChunks, size / TIMESERIES_CHUNK_SIZE));
+        for (size_t i = 1; i < chunks; ++i) {
+            auto const* header(
+                reinterpret_cast<ChunkHeader const*>(data + i * TIMESERIES_CHUNK_SIZE));
+            if (header->magic != CHUNK_MAGIC || header->count == 0 ||
+                header->nameLength > TIMESERIES_NAME_SIZE || header->lastTimestamp < begin ||
+                header->firstTimestamp > end) {
+                continue;
+            }
+            std::string const name(header->name, header->nameLength);
+            if (!sensorNames.empty() && sensorNames.find(name) == sensorNames.end()) {
+                continue;
+            }
+            GorillaDecoder decoder(data + i * TIMESERIES_CHUNK_SIZE + sizeof(ChunkHeader),
+                                   std::min<size_t>(header->bitLength, PAYLOAD_SIZE * 8),
+                                   header->count);
+            Samples& samples(result[name]);
+            int64_t timestamp;
+            int32_t value;
+            while (decoder.next(timestamp, value)) {
+                if (timestamp >= begin && timestamp <= end) {
+                    samples.emplace_back(timestamp, value);
+                }
+            }
+        }
+    }
+
+    std::vector<Path> listSegments() const {
+        std::error_code ec;
+        std::vector<Path> segments;
+        for (auto const& entry : std::filesystem::directory_iterator(mDirectory, ec)) {
+            if (entry.path().extension() == TIMESERIES_SEGMENT_EXTENSION) {
+                segments.emplace_back(entry.path());
+            }
+        }
+        // segments are named after the time they were started
+        std::sort(segments.begin(), segments.end());
+        return segments;
+    }
+
+    std::optional<size_t> allocateChunk(std::string const& sensorName, int64_t timestamp) {
+        auto* segment(reinterpret_cast<SegmentHeader*>(mSegment->data));
+        if (segment->allocatedChunks >= CHUNK_COUNT) {
+            return std::nullopt;
+        }
+        size_t const index(segment->allocatedChunks);
+        ChunkHeader* header(chunkHeader(mSegment->data, index));
+        std::memset(mSegment->data + index * TIMESERIES_CHUNK_SIZE, 0, TIMESERIES_CHUNK_SIZE);
+        header->nameLength = sensorName.size();
+        std::memcpy(header->name, sensorName.data(), sensorName.size());
+        header->firstTimestamp = timestamp;
+        header->lastTimestamp = timestamp;
+        header->magic = CHUNK_MAGIC;
+        segment->allocatedChunks++;
+        return index;
+    }
+
+    bool mapSegment(Path const& path, bool create) {
+        int const fd(::open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0),
+                            0644));
+        if (fd < 0) {
+            logMessage(SR_LL_WRN, "Can't open time-series segment " + path.string());
+            return false;
+        }
+        struct stat st;
+        if ((create && ftruncate(fd, TIMESERIES_SEGMENT_SIZE) != 0) || fstat(fd, &st) != 0 ||
+            st.st_size != TIMESERIES_SEGMENT_SIZE) {
+            ::close(fd);
+            return false;
+        }
+        void* data(
+            mmap(nullptr, TIMESERIES_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            logMessage(SR_LL_WRN, "Can't map time-series segment " + path.string());
+            return false;
+        }
+        auto* segment(static_cast<SegmentHeader*>(data));
+        if (create) {
+            segment->version = VERSION;
+            segment->chunkSize = TIMESERIES_CHUNK_SIZE;
+            segment->allocatedChunks = 1;
+            segment->magic = SEGMENT_MAGIC;
+        } else if (segment->magic != SEGMENT_MAGIC || segment->version != VERSION ||
+                   segment->chunkSize != TIMESERIES_CHUNK_SIZE) {
+            munmap(data, TIMESERIES_SEGMENT_SIZE);
+            return false;
+        }
+        mSegment = MappedSegment{path, static_cast<uint8_t*>(data), TIMESERIES_SEGMENT_SIZE};
+        return true;
+    }
+
+    bool startSegment(int64_t timestamp) {
+        unmap();
+        char name[64];
+        snprintf(name, sizeof(name), "segment-%020lld%s", static_cast<long long>(timestamp),
+                 TIMESERIES_SEGMENT_EXTENSION);
+        if (!mapSegment(mDirectory / name, true)) {
+            return false;
+        }
+        mSegmentStart = timestamp;
+        removeExpiredSegments(timestamp);
+        return true;
+    }
+
+    int64_t retentionMilliseconds() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(mRetention).count();
+    }
+
+    // Time after which the current segment is replaced by a new one
+    int64_t rotationInterval() const {
+        return std::max<int64_t>(1, retentionMilliseconds() / TIMESERIES_SEGMENTS_PER_RETENTION);
+    }
+
+    static std::optional<int64_t> segmentStart(Path const& path) {
+        long long started;
+        if (sscanf(path.stem().string().c_str(), "segment-%lld", &started) != 1) {
+            return std::nullopt;
+        }
+        return started;
+    }
+
+    // A segment has expired when the one started after it is older than the retention time.
+    // Remembers when the oldest remaining segment expires, so that appends don't have to look
+    // at the directory until then.
+    void removeExpiredSegments(int64_t now) {
+        int64_t const oldest(now - retentionMilliseconds());
+        std::vector<Path> const segments(listSegments());
+        mNextExpiry.reset();
+        for (size_t i = 0; i + 1 < segments.size(); ++i) {
+            std::optional<int64_t> const ended(segmentStart(segments[i + 1]));
+            if (!ended) {
+                continue;
+            }
+            if (ended.value() >= oldest) {
+                mNextExpiry = ended.value() + retentionMilliseconds();
+                break;
+            }
+            std::error_code ec;
+            std::filesystem::remove(segments[i], ec);
+        }
+    }
+
+    void unmap() {
+        mOpenChunks.clear();
+        if (mSegment) {
+            msync(mSegment->data, mSegment->size, MS_ASYNC);
+            munmap(mSegment->data, mSegment->size);
+            mSegment.reset();
+        }
+    }
+
+    mutable std::mutex mStoreMtx;
+    Path mDirectory;
+    std::chrono::hours mRetention;
+    std::optional<MappedSegment> mSegment;
+    // start of the current segment in milliseconds
+    int64_t mSegmentStart;
+    std::optional<int64_t> mNextExpiry;
+    std::unordered_map<std::string, OpenChunk> mOpenChunks;
+    std::unordered_set<std::string> mUnstoredNames;
+};
+
+}  // namespace hardware
+
+#endif  // TIMESERIES_STORE_H
@@ -0,0 +1,124 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef TREE_CACHE_H
+#define TREE_CACHE_H
+
+#include <component_data.h>
+#include <inventory_cache.h>
+#include <json_tree.h>
+#include <sensor_data.h>
+#include <tree_patch.h>
+#include <utils/fingerprint.h>
+#include <utils/globals.h>
+
+#include <libyang-cpp/DataNode.hpp>
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace hardware {
+
+// Last operational tree built for a request of the whole hardware tree. Between two requests
+// usually only the sensor values, their history and the statistics change, so a request gets a
+// duplicate of the cached tree with only those leaves changed in place. The cache is only hit
+// while the inventory, the configuration and the sensors with their history windows are the
+// ones the tree was built from.
+struct TreeCache {
+
+    struct Key {
+        bool operator==(Key const&) const = default;
+
+        std::shared_ptr<InventorySnapshot const> inventory;
+        std::shared_ptr<ComponentData::ConfigSnapshot const> config;
+        uint64_t shape;
+        bool setPhysicalID;
+        bool withStatistics;
+    };
+
+    static TreeCache& getInstance() {
+        static TreeCache instance;
+        return instance;
+    }
+
+    TreeCache(TreeCache const&) = delete;
+    void operator=(TreeCache const&) = delete;
+
+    // Hash over the sensors and their history windows, independent of the map order
+    static uint64_t shape(ComponentMap const& hwComponents) {
+        uint64_t result(0);
+        for (auto const& [name, component] : hwComponents) {
+            auto const* sensor(dynamic_cast<Sensor const*>(component.get()));
+            if (!sensor) {
+                continue;
+            }
+            Fingerprint fp;
+            fp.add(name).add(static_cast<uint64_t>(sensor->history.size()));
+            for (auto const& aggregate : sensor->history) {
+                fp.add(static_cast<uint64_t>(aggregate.window.count()));
+            }
+            result += Fingerprint::mix(fp.value());
+        }
+        return result;
+    }
+
+    std::optional<libyang::DataNode> get(Key const& key,
+                                         std::optional<std::string> const& lastChange,
+                                         ComponentMap const& hwComponents,
+                                         std::optional<JsonTree::Statistics> const& statistics) {
+        std::optional<libyang::DataNode> tree;
+        {
+            std::lock_guard lk(mCacheMtx);
+            if (!mTree || !mKey || !(mKey.value() == key)) {
+                return std::nullopt;
+            }
+            tree = mTree->duplicateWithSiblings(libyang::DuplicationOptions::Recursive);
+        }
+
+        bool patched(true);
+        if (lastChange) {
+            patched &= TreePatch::lastChange(tree.value(), lastChange.value());
+        }
+        if (statistics) {
+            patched &= TreePatch::statistics(tree.value(), statistics.value());
+        }
+        for (auto const& [name, component] : hwComponents) {
+            auto const* sensor(dynamic_cast<Sensor const*>(component.get()));
+            if (sensor && patched) {
+                patched &= TreePatch::sensor(tree.value(), *sensor);
+            }
+        }
+        if (!patched) {
+            logMessage(SR_LL_DBG, "Cached hardware tree doesn't match, building it again.");
+            return std::nullopt;
+        }
+        return tree;
+    }
+
+    void store(Key const& key, libyang::DataNode const& tree) {
+        libyang::DataNode copy(tree.duplicateWithSiblings(libyang::DuplicationOptions::Recursive));
+        std::lock_guard lk(mCacheMtx);
+        mKey = key;
+        mTree = copy;
+    }
+
+private:
+    TreeCache() = default;
+
+    std::mutex mCacheMtx;
+    std::optional<Key> mKey;
+    std::optional<libyang::DataNode> mTree;
+};
+
+}  // namespace hardware
+
+#endif  // TREE_CACHE_H
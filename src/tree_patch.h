@@ -0,0 +1,104 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef TREE_PATCH_H
+#define TREE_PATCH_H
+
+#include <json_tree.h>
+#include <sensor_data.h>
+#include <utils/globals.h>
+
+#include <libyang-cpp/DataNode.hpp>
+#include <libyang/libyang.h>
+
+#include <string>
+#include <vector>
+
+namespace hardware {
+
+// Changes the leaves of a built operational tree that follow the sensor samples in place. A patch
+// fails if a leaf isn't in the tree, the tree then has to be built again. Leaves whose value
+// really changed are appended to the optional list.
+struct TreePatch {
+
+    using Changed = std::vector<libyang::DataNode>;
+
+    static std::string hardwarePath() {
+        return "/ietf-hardware:hardware";
+    }
+
+    static bool lastChange(libyang::DataNode const& tree,
+                           std::string const& lastChange,
+                           Changed* changed = nullptr) {
+        return change(tree, hardwarePath() + "/last-change", lastChange, changed);
+    }
+
+    static bool statistics(libyang::DataNode const& tree,
+                           JsonTree::Statistics const& statistics,
+                           Changed* changed = nullptr) {
+        std::string const statisticsPath(
+            hardwarePath() + "/hardware-plugin-augment:plugin-settings/notification-statistics");
+        bool patched(change(tree, statisticsPath + "/dropped",
+                            std::to_string(statistics.dropped), changed));
+        patched &= change(tree, statisticsPath + "/coalesced",
+                          std::to_string(statistics.coalesced), changed);
+        return patched;
+    }
+
+    static bool sensor(libyang::DataNode const& tree,
+                       Sensor const& sensor,
+                       Changed* changed = nullptr) {
+        auto const component(
+            tree.findPath(hardwarePath() + "/component[name='" + sensor.name + "']"));
+        if (!component) {
+            return false;
+        }
+        bool patched(change(component.value(), "sensor-data/value", std::to_string(sensor.value),
+                            changed));
+        std::optional<std::string> const timestamp(sensor.valueTimestampString());
+        if (timestamp) {
+            patched &= change(component.value(), "sensor-data/value-timestamp",
+                              timestamp.value(), changed);
+        }
+        for (auto const& aggregate : sensor.history) {
+            std::string const historyPath("sensor-data/hardware-plugin-augment:history[window='" +
+                                          std::to_string(aggregate.window.count()) + "']");
+            patched &= change(component.value(), historyPath + "/samples",
+                              std::to_string(aggregate.samples), changed);
+            patched &= change(component.value(), historyPath + "/minimum",
+                              std::to_string(aggregate.minimum), changed);
+            patched &= change(component.value(), historyPath + "/maximum",
+                              std::to_string(aggregate.maximum), changed);
+            patched &= change(component.value(), historyPath + "/average",
+                              std::to_string(aggregate.average), changed);
+        }
+        return patched;
+    }
+
+private:
+    static bool change(libyang::DataNode const& node,
+                       std::string const& path,
+                       std::string const& value,
+                       Changed* changed) {
+        auto const leaf(node.findPath(path));
+        if (!leaf) {
+            return false;
+        }
+        LY_ERR const rc(lyd_change_term(libyang::getRawNode(leaf.value()), value.c_str()));
+        if (rc == LY_SUCCESS && changed) {
+            changed->push_back(leaf.value());
+        }
+        return rc == LY_SUCCESS || rc == LY_EEXIST || rc == LY_ENOT;
+    }
+};
+
+}  // namespace hardware
+
+#endif  // TREE_PATCH_H
@@ -0,0 +1,111 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef BOUNDED_RING_H
+#define BOUNDED_RING_H
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded lock-free ring after Dmitry Vyukov's MPMC queue. Every cell carries a sequence number
+// telling whether it is free for the producer or filled for the consumer of the current lap, so
+// neither side ever takes a lock. Any number of threads may push, and besides the consumer a
+// producer may pop as well, e.g. to discard the oldest element when the ring is full.
+template <typename T>
+struct BoundedRing {
+
+    // The capacity is rounded up to a power of two
+    BoundedRing(size_t capacity)
+        : mCapacity(roundUp(capacity)), mMask(mCapacity - 1), mCells(new Cell[mCapacity]),
+          mEnqueuePos(0), mDequeuePos(0) {
+        for (size_t i = 0; i < mCapacity; ++i) {
+            mCells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedRing(BoundedRing const&) = delete;
+    void operator=(BoundedRing const&) = delete;
+
+    // Fails if the ring is full
+    bool tryPush(T&& value) {
+        Cell* cell;
+        size_t pos(mEnqueuePos.load(std::memory_order_relaxed));
+        while (true) {
+            cell = &mCells[pos & mMask];
+            size_t const sequence(cell->sequence.load(std::memory_order_acquire));
+            intptr_t const diff(intptr_t(sequence) - intptr_t(pos));
+            if (diff == 0) {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> tryPop() {
+        Cell* cell;
+        size_t pos(mDequeuePos.load(std::memory_order_relaxed));
+        while (true) {
+            cell = &mCells[pos & mMask];
+            size_t const sequence(cell->sequence.load(std::memory_order_acquire));
+            intptr_t const diff(intptr_t(sequence) - intptr_t(pos + 1));
+            if (diff == 0) {
+                if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;
+            } else {
+                pos = mDequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        std::optional<T> value(std::move(cell->data));
+        cell->data = T();
+        cell->sequence.store(pos + mMask + 1, std::memory_order_release);
+        return value;
+    }
+
+    size_t capacity() const {
+        return mCapacity;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    static size_t roundUp(size_t capacity) {
+        size_t result(2);
+        while (result < capacity) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    size_t const mCapacity;
+    size_t const mMask;
+    std::unique_ptr<Cell[]> mCells;
+    // producers and the consumer don't share cache lines
+    alignas(64) std::atomic<size_t> mEnqueuePos;
+    alignas(64) std::atomic<size_t> mDequeuePos;
+};
+
+#endif  // BOUNDED_RING_H
@@ -0,0 +1,68 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <stdint.h>
+
+#include <optional>
+#include <string_view>
+
+// Incremental FNV-1a hash used for detecting content changes, not suited for cryptographic use.
+struct Fingerprint {
+
+    Fingerprint() : hash(0xcbf29ce484222325ULL){};
+
+    Fingerprint& add(std::string_view data) {
+        add(static_cast<uint64_t>(data.size()));
+        addBytes(data.data(), data.size());
+        return *this;
+    }
+
+    Fingerprint& add(uint64_t data) {
+        addBytes(&data, sizeof(data));
+        return *this;
+    }
+
+    template <typename T>
+    Fingerprint& add(std::optional<T> const& data) {
+        add(static_cast<uint64_t>(data.has_value()));
+        if (data) {
+            add(data.value());
+        }
+        return *this;
+    }
+
+    uint64_t value() const {
+        return hash;
+    }
+
+    // Spreads a hash over all bits so that hashes can be combined by addition
+    static uint64_t mix(uint64_t value) {
+        value += 0x9e3779b97f4a7c15ULL;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+
+private:
+    void addBytes(void const* data, size_t size) {
+        auto const* bytes = static_cast<unsigned char const*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ULL;
+        }
+    }
+
+    uint64_t hash;
+};
+
+#endif  // FINGERPRINT_H
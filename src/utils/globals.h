@@ -14,8 +14,31 @@
 #include <sysrepo-cpp/Session.hpp>
 #include <sysrepo.h>
 
-#define COMPONENTS_LOCATION "/tmp/hardware_components.json"
+#define LSHW_LOCATION "/usr/bin/lshw"
+#define LSHW_READ_BUFFER_SIZE 16384  // bytes
+#define SYSFS_DMI_LOCATION "/sys/class/dmi/id"
+#define SYSFS_PCI_LOCATION "/sys/bus/pci/devices"
+#define SYSFS_NET_LOCATION "/sys/class/net"
+#define SYSFS_BLOCK_LOCATION "/sys/block"
+#define SYSFS_CPU_LOCATION "/sys/devices/system/cpu"
+#define SYSFS_HWMON_LOCATION "/sys/class/hwmon"
+#define HWMON_READ_BUFFER_SIZE 32  // bytes
+#define DEFAULT_INVENTORY_CACHE_TTL 60  // seconds
 #define DEFAULT_POLL_INTERVAL 60  // seconds
+#define DEFAULT_SENSOR_SAMPLE_INTERVAL 10  // seconds
+#define CONFIG_UPDATE_COMPONENT_LIMIT 16  // components read one by one on a change
+#define SAMPLER_TICK_MS 100  // milliseconds
+#define ADAPTIVE_POLL_PROXIMITY 10  // percent of a threshold value
+#define ADAPTIVE_POLL_SAMPLES 4  // before a threshold is reached
+#define NOTIFICATION_QUEUE_SIZE 1024  // notifications
+#define HISTORY_BUCKETS 60  // per history window
+#define TIMESERIES_LOCATION "/var/lib/sysrepo-plugin-hardware/timeseries"
+#define TIMESERIES_SEGMENT_EXTENSION ".tsdb"
+#define TIMESERIES_SEGMENT_SIZE 4194304  // bytes
+#define TIMESERIES_CHUNK_SIZE 512  // bytes
+#define TIMESERIES_NAME_SIZE 64  // bytes
+#define DEFAULT_TIMESERIES_RETENTION 24  // hours
+#define TIMESERIES_SEGMENTS_PER_RETENTION 24  // segments started within a retention period
 
 struct SensorsInitFail : public std::exception {
     const char* what() const throw() override {
@@ -59,4 +82,38 @@ static bool setXpath(sysrepo::Session& session,
     return true;
 }
 
+// Creates the node at an absolute path, usually a list instance, and returns it so that its
+// members can be set relative to it without parsing its path and searching it again
+static std::optional<libyang::DataNode> createXpath(sysrepo::Session& session,
+                                                    std::optional<libyang::DataNode>& parent,
+                                                    std::string const& node_xpath) {
+    try {
+        if (!parent) {
+            auto const created(session.getContext().newPath2(node_xpath));
+            parent = created.createdParent;
+            return created.createdNode;
+        }
+        auto const created(parent.value().newPath2(node_xpath));
+        return created.createdNode ? created.createdNode : parent.value().findPath(node_xpath);
+    } catch (std::runtime_error const& e) {
+        logMessage(SR_LL_WRN, "At path " + node_xpath + ", error: " + e.what());
+    }
+    return std::nullopt;
+}
+
+// Creates a child of a node returned by createXpath, the path is relative to that node
+static std::optional<libyang::DataNode>
+    setXpath(libyang::DataNode const& node,
+             std::string const& relative_xpath,
+             std::optional<std::string> const& value = std::nullopt) {
+    try {
+        auto const created(node.newPath2(relative_xpath, value));
+        return created.createdNode ? created.createdNode : node.findPath(relative_xpath);
+    } catch (std::runtime_error const& e) {
+        logMessage(SR_LL_WRN, "At path " + relative_xpath + ", value " + value.value_or("") +
+                                  ", error: " + e.what());
+    }
+    return std::nullopt;
+}
+
 #endif  // GLOBALS_H
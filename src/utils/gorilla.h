@@ -0,0 +1,254 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef GORILLA_H
+#define GORILLA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compression of (timestamp, int32 value) series as described in "Gorilla: A Fast, Scalable,
+// In-Memory Time Series Database". The first sample is stored as is, every following timestamp
+// as the difference between its delta and the previous delta, and every following value as the
+// XOR with the previous value, which only has a few meaningful bits for slowly changing sensors.
+// Bits are written MSB first into a zeroed buffer, so an encoder can write straight into a
+// memory mapped file.
+
+struct GorillaEncoder {
+
+    // Bits needed for a sample in the worst case
+    static constexpr size_t MAX_SAMPLE_BITS = 64 + 32;
+
+    GorillaEncoder(uint8_t* buffer, size_t capacityBits)
+        : mBuffer(buffer), mCapacityBits(capacityBits), mBitLength(0), mCount(0),
+          mPreviousTimestamp(0), mPreviousDelta(0), mPreviousValue(0), mLeading(0),
+          mTrailing(0){};
+
+    // Fails if the sample doesn't fit into the buffer or its timestamp can't be encoded, which
+    // leaves the buffer untouched
+    bool append(int64_t timestamp, int32_t value) {
+        if (mBitLength + MAX_SAMPLE_BITS > mCapacityBits) {
+            return false;
+        }
+        if (mCount == 0) {
+            write(uint64_t(timestamp), 64);
+            write(uint32_t(value), 32);
+        } else {
+            int64_t const delta(timestamp - mPreviousTimestamp);
+            int64_t const deltaOfDelta(delta - mPreviousDelta);
+            if (delta < 0 || deltaOfDelta < INT32_MIN || deltaOfDelta > INT32_MAX) {
+                return false;
+            }
+            writeTimestamp(deltaOfDelta);
+            writeValue(uint32_t(value) ^ uint32_t(mPreviousValue));
+            mPreviousDelta = delta;
+        }
+        mPreviousTimestamp = timestamp;
+        mPreviousValue = value;
+        mCount++;
+        return true;
+    }
+
+    size_t bitLength() const {
+        return mBitLength;
+    }
+
+    uint32_t count() const {
+        return mCount;
+    }
+
+private:
+    void writeTimestamp(int64_t deltaOfDelta) {
+        if (deltaOfDelta == 0) {
+            write(0b0, 1);
+        } else if (deltaOfDelta >= -63 && deltaOfDelta <= 64) {
+            write(0b10, 2);
+            write(uint64_t(deltaOfDelta + 63), 7);
+        } else if (deltaOfDelta >= -255 && deltaOfDelta <= 256) {
+            write(0b110, 3);
+            write(uint64_t(deltaOfDelta + 255), 9);
+        } else if (deltaOfDelta >= -2047 && deltaOfDelta <= 2048) {
+            write(0b1110, 4);
+            write(uint64_t(deltaOfDelta + 2047), 12);
+        } else {
+            write(0b1111, 4);
+            write(uint32_t(int32_t(deltaOfDelta)), 32);
+        }
+    }
+
+    void writeValue(uint32_t xorValue) {
+        if (xorValue == 0) {
+            write(0b0, 1);
+            return;
+        }
+        uint32_t const leading(__builtin_clz(xorValue));
+        uint32_t const trailing(__builtin_ctz(xorValue));
+        if (mCount > 1 && leading >= mLeading && trailing >= mTrailing) {
+            // meaningful bits fit into the window of the previous value
+            write(0b10, 2);
+            write(xorValue >> mTrailing, 32 - mLeading - mTrailing);
+            return;
+        }
+        uint32_t const meaningful(32 - leading - trailing);
+        write(0b11, 2);
+        write(leading, 5);
+        write(meaningful - 1, 5);
+        write(xorValue >> trailing, meaningful);
+        mLeading = leading;
+        mTrailing = trailing;
+    }
+
+    void write(uint64_t bits, uint32_t length) {
+        for (uint32_t i = length; i > 0; --i) {
+            if ((bits >> (i - 1)) & 1) {
+                mBuffer[mBitLength / 8] |= uint8_t(0x80 >> (mBitLength % 8));
+            }
+            mBitLength++;
+        }
+    }
+
+    uint8_t* mBuffer;
+    size_t mCapacityBits;
+    size_t mBitLength;
+    uint32_t mCount;
+    int64_t mPreviousTimestamp;
+    int64_t mPreviousDelta;
+    int32_t mPreviousValue;
+    uint32_t mLeading;
+    uint32_t mTrailing;
+};
+
+struct GorillaDecoder {
+
+    GorillaDecoder(uint8_t const* buffer, size_t bitLength, uint32_t count)
+        : mBuffer(buffer), mBitLength(bitLength), mPosition(0), mCount(count), mDecoded(0),
+          mTimestamp(0), mDelta(0), mValue(0), mLeading(0), mTrailing(0){};
+
+    bool next(int64_t& timestamp, int32_t& value) {
+        if (mDecoded >= mCount) {
+            return false;
+        }
+        if (mDecoded == 0) {
+            if (!read(64, mTimestamp)) {
+                return false;
+            }
+            uint64_t first;
+            if (!read(32, first)) {
+                return false;
+            }
+            mValue = int32_t(uint32_t(first));
+        } else if (!readTimestamp() || !readValue()) {
+            return false;
+        }
+        mDecoded++;
+        timestamp = int64_t(mTimestamp);
+        value = mValue;
+        return true;
+    }
+
+private:
+    bool readTimestamp() {
+        uint32_t prefix(0);
+        uint64_t bit;
+        while (prefix < 4) {
+            if (!read(1, bit)) {
+                return false;
+            }
+            if (!bit) {
+                break;
+            }
+            prefix++;
+        }
+        int64_t deltaOfDelta(0);
+        uint64_t bits;
+        switch (prefix) {
+        case 0:
+            break;
+        case 1:
+            if (!read(7, bits)) {
+                return false;
+            }
+            deltaOfDelta = int64_t(bits) - 63;
+            break;
+        case 2:
+            if (!read(9, bits)) {
+                return false;
+            }
+            deltaOfDelta = int64_t(bits) - 255;
+            break;
+        case 3:
+            if (!read(12, bits)) {
+                return false;
+            }
+            deltaOfDelta = int64_t(bits) - 2047;
+            break;
+        default:
+            if (!read(32, bits)) {
+                return false;
+            }
+            deltaOfDelta = int32_t(uint32_t(bits));
+        }
+        mDelta += deltaOfDelta;
+        mTimestamp += mDelta;
+        return true;
+    }
+
+    bool readValue() {
+        uint64_t bit;
+        if (!read(1, bit)) {
+            return false;
+        }
+        if (!bit) {
+            return true;
+        }
+        if (!read(1, bit)) {
+            return false;
+        }
+        if (bit) {
+            uint64_t leading, meaningful;
+            if (!read(5, leading) || !read(5, meaningful)) {
+                return false;
+            }
+            mLeading = uint32_t(leading);
+            mTrailing = 32 - mLeading - uint32_t(meaningful + 1);
+        }
+        uint64_t bits;
+        if (!read(32 - mLeading - mTrailing, bits)) {
+            return false;
+        }
+        mValue = int32_t(uint32_t(mValue) ^ (uint32_t(bits) << mTrailing));
+        return true;
+    }
+
+    bool read(uint32_t length, uint64_t& bits) {
+        if (mPosition + length > mBitLength) {
+            return false;
+        }
+        bits = 0;
+        for (uint32_t i = 0; i < length; ++i) {
+            bits = (bits << 1) | ((mBuffer[mPosition / 8] >> (7 - mPosition % 8)) & 1);
+            mPosition++;
+        }
+        return true;
+    }
+
+    uint8_t const* mBuffer;
+    size_t mBitLength;
+    size_t mPosition;
+    uint32_t mCount;
+    uint32_t mDecoded;
+    uint64_t mTimestamp;
+    int64_t mDelta;
+    int32_t mValue;
+    uint32_t mLeading;
+    uint32_t mTrailing;
+};
+
+#endif  // GORILLA_H
@@ -0,0 +1,194 @@
+// telekom / sysrepo-plugin-hardware
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2021 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Hierarchical timer wheel keyed by timer identity. Deadlines are absolute tick numbers, each
+// level covers 64 times the range of the level below it. Timers beyond the range of the highest
+// level are parked in it and re-inserted until they get into range. Rescheduling or cancelling a
+// timer only invalidates its old slot entry, which is dropped when its slot is processed. Every
+// level keeps a bitmap of its occupied slots, so the earliest deadline is found by looking at the
+// first occupied slot of each level instead of at every timer.
+template <typename Key>
+struct TimerWheel {
+
+    static constexpr uint32_t LEVELS = 4;
+    static constexpr uint32_t SLOT_BITS = 6;
+    static constexpr uint64_t SLOTS = 1 << SLOT_BITS;
+    static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+
+    TimerWheel(uint64_t currentTick = 0) : mCurrentTick(currentTick), mGeneration(0){};
+
+    // Deadlines that are due already expire on the next tick
+    void schedule(Key const& key, uint64_t deadline) {
+        if (deadline <= mCurrentTick) {
+            deadline = mCurrentTick + 1;
+        }
+        Timer& timer = mTimers[key];
+        timer.deadline = deadline;
+        timer.generation = ++mGeneration;
+        insert(key, timer);
+    }
+
+    void cancel(Key const& key) {
+        mTimers.erase(key);
+    }
+
+    bool contains(Key const& key) const {
+        return mTimers.find(key) != mTimers.end();
+    }
+
+    // Earliest deadline of all scheduled timers. Below the highest level the slots of a level are
+    // ordered by their deadlines starting after the slot of the current tick, so only the first
+    // slot that still holds a valid entry has to be looked at. The highest level also holds
+    // parked timers out of that order and is looked at as a whole. Invalidated entries found on
+    // the way are dropped.
+    std::optional<uint64_t> nextDeadline() {
+        std::optional<uint64_t> next;
+        for (uint32_t level = 0; level < LEVELS; ++level) {
+            uint64_t const start(((mCurrentTick >> (level * SLOT_BITS)) + 1) & SLOT_MASK);
+            uint64_t pending(std::rotr(mOccupied[level], int(start)));
+            while (pending) {
+                int const offset(std::countr_zero(pending));
+                pending &= pending - 1;
+                std::optional<uint64_t> const earliest(
+                    pruneSlot(level, (start + offset) & SLOT_MASK));
+                if (earliest) {
+                    next = next ? std::min(next.value(), earliest.value()) : earliest;
+                    if (level < LEVELS - 1) {
+                        break;
+                    }
+                }
+            }
+        }
+        return next;
+    }
+
+    uint64_t currentTick() const {
+        return mCurrentTick;
+    }
+
+    // Moves the wheel forward to the given tick, expired timers are removed from the wheel and
+    // returned together with their deadline
+    void advance(uint64_t tick, std::vector<std::pair<Key, uint64_t>>& expired) {
+        if (mTimers.empty()) {
+            mCurrentTick = std::max(mCurrentTick, tick);
+            return;
+        }
+        while (mCurrentTick < tick) {
+            mCurrentTick++;
+            cascade();
+
+            std::vector<Entry> entries;
+            take(0, mCurrentTick & SLOT_MASK, entries);
+            for (auto const& entry : entries) {
+                auto const& timer = mTimers.find(entry.key);
+                if (timer == mTimers.end() || timer->second.generation != entry.generation) {
+                    continue;
+                }
+                if (timer->second.deadline <= mCurrentTick) {
+                    expired.emplace_back(entry.key, timer->second.deadline);
+                    mTimers.erase(timer);
+                } else {
+                    insert(entry.key, timer->second);
+                }
+            }
+        }
+    }
+
+private:
+    struct Timer {
+        uint64_t deadline;
+        uint64_t generation;
+    };
+
+    struct Entry {
+        Key key;
+        uint64_t generation;
+    };
+
+    void insert(Key const& key, Timer const& timer) {
+        uint64_t const delta(timer.deadline - mCurrentTick);
+        uint32_t level(0);
+        while (level < LEVELS - 1 && delta >= (SLOTS << (level * SLOT_BITS))) {
+            level++;
+        }
+        uint64_t deadline(timer.deadline);
+        if (level == LEVELS - 1 && delta >= (SLOTS << (level * SLOT_BITS))) {
+            // out of range, park it in the furthest slot of the highest level
+            deadline = mCurrentTick + (SLOT_MASK << (level * SLOT_BITS));
+        }
+        uint64_t const slot((deadline >> (level * SLOT_BITS)) & SLOT_MASK);
+        mSlots[level][slot].push_back(Entry{key, timer.generation});
+        mOccupied[level] |= 1ULL << slot;
+    }
+
+    void take(uint32_t level, uint64_t slot, std::vector<Entry>& entries) {
+        entries.swap(mSlots[level][slot]);
+        mOccupied[level] &= ~(1ULL << slot);
+    }
+
+    // Drops the invalidated entries of a slot and returns the earliest deadline of the others
+    std::optional<uint64_t> pruneSlot(uint32_t level, uint64_t slot) {
+        std::vector<Entry>& entries = mSlots[level][slot];
+        std::optional<uint64_t> earliest;
+        auto const stale = [this, &earliest](Entry const& entry) {
+            auto const& timer = mTimers.find(entry.key);
+            if (timer == mTimers.end() || timer->second.generation != entry.generation) {
+                return true;
+            }
+            earliest = earliest ? std::min(earliest.value(), timer->second.deadline)
+                                : timer->second.deadline;
+            return false;
+        };
+        entries.erase(std::remove_if(entries.begin(), entries.end(), stale), entries.end());
+        if (entries.empty()) {
+            mOccupied[level] &= ~(1ULL << slot);
+        }
+        return earliest;
+    }
+
+    // Redistributes the timers of the higher level slots that the current tick has reached
+    void cascade() {
+        for (uint32_t level = 1; level < LEVELS; ++level) {
+            if ((mCurrentTick & ((1ULL << (level * SLOT_BITS)) - 1)) != 0) {
+                return;
+            }
+            std::vector<Entry> entries;
+            take(level, (mCurrentTick >> (level * SLOT_BITS)) & SLOT_MASK, entries);
+            for (auto const& entry : entries) {
+                auto const& timer = mTimers.find(entry.key);
+                if (timer != mTimers.end() && timer->second.generation == entry.generation) {
+                    insert(entry.key, timer->second);
+                }
+            }
+        }
+    }
+
+    std::unordered_map<Key, Timer> mTimers;
+    std::array<std::array<std::vector<Entry>, SLOTS>, LEVELS> mSlots;
+    // bit n is set while slot n of a level holds entries
+    std::array<uint64_t, LEVELS> mOccupied{};
+    uint64_t mCurrentTick;
+    uint64_t mGeneration;
+};
+
+#endif  // TIMER_WHEEL_H